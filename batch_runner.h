@@ -0,0 +1,653 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include "pipe_manager.h"
+#include "compress_manager.h"
+#include "file_manager.h"
+#include "network_manager.h"
+#include "query_planner.h"
+#include "self_check.h"
+#include "logger.h"
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <cctype>
+#include <limits>
+
+using namespace std;
+
+// Аргументы команды пакетного режима. Ошибка разбора запоминается, команда ее проверяет.
+class BatchArgs {
+private:
+    vector<string> tokens;
+    string error;
+
+public:
+    explicit BatchArgs(vector<string> parts) : tokens(move(parts)) {}
+
+    size_t Count() const { return tokens.size(); }
+    bool Has(size_t i) const { return i < tokens.size(); }
+    const string& Error() const { return error; }
+    void Fail(const string& message) { if (error.empty()) error = message; }
+
+    // Число аргументов в [minCount, maxCount]
+    bool Expect(size_t minCount, size_t maxCount, const string& usage) {
+        if (tokens.size() < minCount || tokens.size() > maxCount) Fail("usage: " + usage);
+        return error.empty();
+    }
+
+    string Str(size_t i) const { return Has(i) ? tokens[i] : string(); }
+
+    int Int(size_t i) {
+        if (!Has(i)) { Fail("missing argument " + to_string(i + 1)); return 0; }
+        char* end = nullptr;
+        errno = 0;
+        long value = strtol(tokens[i].c_str(), &end, 10);
+        if (errno || *end || end == tokens[i].c_str()) Fail("not an integer: " + tokens[i]);
+        return (int)value;
+    }
+
+    double Double(size_t i) {
+        if (!Has(i)) { Fail("missing argument " + to_string(i + 1)); return 0; }
+        char* end = nullptr;
+        errno = 0;
+        double value = strtod(tokens[i].c_str(), &end);
+        if (errno || *end || end == tokens[i].c_str()) Fail("not a number: " + tokens[i]);
+        return value;
+    }
+
+    bool Flag(size_t i) {
+        int value = Int(i);
+        if (Has(i) && value != 0 && value != 1) Fail("expected 0 or 1: " + tokens[i]);
+        return value == 1;
+    }
+};
+
+// Результат команды: поля в порядке добавления. Значения хранятся уже в виде JSON.
+class BatchReply {
+private:
+    vector<pair<string, string>> fields;
+    string error;
+
+public:
+    static string Quote(const string& text) {
+        string result = "\"";
+        for (unsigned char ch : text) {
+            switch (ch) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (ch < 0x20) {
+                        char code[8];
+                        snprintf(code, sizeof(code), "\\u%04x", ch);
+                        result += code;
+                    } else {
+                        result += (char)ch;
+                    }
+            }
+        }
+        return result + "\"";
+    }
+
+    static string Number(double value) {
+        if (value != value || value == numeric_limits<double>::infinity() || value == -numeric_limits<double>::infinity()) return "null";
+        ostringstream ss;
+        ss << setprecision(15) << value;
+        return ss.str();
+    }
+
+    void Fail(const string& message) { if (error.empty()) error = message; }
+    bool Ok() const { return error.empty(); }
+    const string& Error() const { return error; }
+
+    void Add(const string& key, const string& value) { fields.push_back({key, Quote(value)}); }
+    void Add(const string& key, const char* value) { Add(key, string(value)); }
+    void Add(const string& key, bool value) { fields.push_back({key, value ? "true" : "false"}); }
+    void Add(const string& key, int value) { fields.push_back({key, to_string(value)}); }
+    void Add(const string& key, size_t value) { fields.push_back({key, to_string(value)}); }
+    void Add(const string& key, double value) { fields.push_back({key, Number(value)}); }
+
+    void Add(const string& key, const vector<int>& values) {
+        string list = "[";
+        for (size_t i = 0; i < values.size(); i++) list += (i ? "," : "") + to_string(values[i]);
+        fields.push_back({key, list + "]"});
+    }
+
+    void Add(const string& key, const vector<double>& values) {
+        string list = "[";
+        for (size_t i = 0; i < values.size(); i++) list += (i ? "," : "") + Number(values[i]);
+        fields.push_back({key, list + "]"});
+    }
+
+    void WriteJson(ostream& out, const string& command, size_t line, double micros, const string& output) const {
+        out << "{\"line\":" << line << ",\"cmd\":" << Quote(command) << ",\"ok\":" << (Ok() ? "true" : "false");
+        if (!Ok()) out << ",\"error\":" << Quote(error);
+        for (const auto& field : fields) out << "," << Quote(field.first) << ":" << field.second;
+        if (!output.empty()) out << ",\"output\":" << Quote(output);
+        out << ",\"us\":" << Number(micros) << "}\n";
+    }
+
+    // Текст: "ok cmd key=value ..." или "error line N: cmd: message"
+    void WriteText(ostream& out, const string& command, size_t line, const string& output) const {
+        out << output;
+        if (!Ok()) {
+            out << "error line " << line << ": " << command << ": " << error << "\n";
+            return;
+        }
+        out << "ok " << command;
+        for (const auto& field : fields) {
+            const string& value = field.second;
+            bool quoted = value.size() >= 2 && value.front() == '"';
+            out << " " << field.first << "=" << (quoted ? value.substr(1, value.size() - 2) : value);
+        }
+        out << "\n";
+    }
+};
+
+// Пакетный режим без диалога: одна команда на строку, # - комментарий.
+// Аргументы разделяются пробелами, строку с пробелами можно взять в двойные кавычки.
+// Вывод копится в буфере потока и не сбрасывается после каждой строки; сообщения,
+// которые команды пишут в cout (сохранение, загрузка), перехватываются и идут в ответ.
+class BatchRunner {
+public:
+    using Handler = function<void(BatchArgs&, BatchReply&)>;
+
+private:
+    PipeManager& pipeManager;
+    CompressManager& compressManager;
+    FileManager& fileManager;
+    Logger& logger;
+    int& nextPipeId;
+    int& nextCompressId;
+    NetworkManager networkManager;
+    SearchEngine searchEngine;
+    QueryPlanner queryPlanner;
+
+    map<string, pair<string, Handler>> commands;   // имя -> (синтаксис, обработчик)
+    bool json;
+    TaskTimings taskTimings;                         // задачи планировщиков за текущую команду
+
+public:
+    BatchRunner(PipeManager& pm, CompressManager& cm, FileManager& fm, Logger& log, int& pipeId, int& compressId, bool jsonOutput)
+        : pipeManager(pm), compressManager(cm), fileManager(fm), logger(log),
+          nextPipeId(pipeId), nextCompressId(compressId), networkManager(pm, cm),
+          searchEngine(log), queryPlanner(searchEngine, log), json(jsonOutput) {
+        RegisterCommands();
+    }
+
+    struct Summary {
+        size_t commands = 0;
+        size_t failed = 0;
+    };
+
+    // Выполнение потока команд до конца или до quit
+    Summary Run(istream& in, ostream& target) {
+        ostream out(target.rdbuf());   // свой поток над тем же буфером: cout перехватывается отдельно
+        Summary summary;
+        string text;
+        size_t line = 0;
+        logger.Log("BATCH STARTED");
+        // Пакет выполняется один: задачи общего планировщика относятся к текущей команде
+        TaskScheduler::Shared().SetTimingHook(taskTimings.Hook());
+        while (getline(in, text)) {
+            line++;
+            vector<string> tokens;
+            string error;
+            if (!Tokenize(text, tokens, error)) {
+                BatchReply reply;
+                reply.Fail(error);
+                Write(out, reply, "?", line, 0, "");
+                summary.commands++;
+                summary.failed++;
+                continue;
+            }
+            if (tokens.empty()) continue;
+            string command = tokens[0];
+            tokens.erase(tokens.begin());
+            if (command == "quit" || command == "exit") break;
+
+            BatchReply reply;
+            string output;
+            auto started = chrono::steady_clock::now();
+            Execute(command, BatchArgs(move(tokens)), reply, output);
+            double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+            Write(out, reply, command, line, micros, output);
+            summary.commands++;
+            if (!reply.Ok()) summary.failed++;
+        }
+        TaskScheduler::Shared().SetTimingHook(nullptr);
+        out.flush();
+        logger.Log("BATCH FINISHED - Commands: " + to_string(summary.commands) + ", Failed: " + to_string(summary.failed));
+        return summary;
+    }
+
+    // Выполнение одной команды (без разбора строки)
+    void Execute(const string& command, BatchArgs args, BatchReply& reply, string& output) {
+        auto it = commands.find(command);
+        if (it == commands.end()) {
+            reply.Fail("unknown command (try 'help')");
+            return;
+        }
+        ostringstream captured;
+        streambuf* original = cout.rdbuf(captured.rdbuf());
+        taskTimings.Clear();
+        it->second.second(args, reply);
+        cout.rdbuf(original);
+        output = captured.str();
+        if (!args.Error().empty()) reply.Fail(args.Error());
+        // Итоги задач по меткам: <метка>-tasks и <метка>-ms (время всех потоков)
+        for (const auto& entry : taskTimings.Totals()) {
+            reply.Add(entry.first + "-tasks", entry.second.tasks);
+            reply.Add(entry.first + "-ms", chrono::duration<double, milli>(entry.second.elapsed).count());
+        }
+        // Между командами указатели на записи никто не держит: можно убрать пустые слоты
+        pipeManager.CompactIfSparse();
+        compressManager.CompactIfSparse();
+    }
+
+    static constexpr const char* PATH_USAGE = "path <from_cs> <to_cs> [dijkstra|bidirectional|alt|ch]";
+    static constexpr const char* FLOW_USAGE = "maxflow <source_cs> <sink_cs> [dinic|push-relabel]";
+
+    // Запросы к сети; Network - NetworkManager или NetworkReader (закрепленная версия)
+    template<typename Network>
+    static void ShortestPath(Network& network, BatchArgs& args, BatchReply& reply) {
+        if (!args.Expect(2, 3, PATH_USAGE)) return;
+        int from = args.Int(0), to = args.Int(1);
+        PathAlgorithm algorithm = ParsePathAlgorithm(args, 2);
+        if (!args.Error().empty()) return;
+        ShortestPathResult result = network.ComputeShortestPath(from, to, algorithm);
+        if (!result.error.empty()) return reply.Fail(result.error);
+        reply.Add("found", result.found);
+        if (result.found) {
+            reply.Add("length", result.length);
+            reply.Add("stations", result.stations);
+            reply.Add("pipes", result.pipes);
+        }
+        reply.Add("settled", result.settled);
+    }
+
+    template<typename Network>
+    static void MaxFlow(Network& network, BatchArgs& args, BatchReply& reply) {
+        if (!args.Expect(2, 3, FLOW_USAGE)) return;
+        int source = args.Int(0), sink = args.Int(1);
+        MaxFlowAlgorithm algorithm = ParseFlowAlgorithm(args, 2);
+        if (!args.Error().empty()) return;
+        MaxFlowResult result = network.ComputeMaxFlow(source, sink, algorithm);
+        if (!result.Ok()) return reply.Fail(result.error);
+        reply.Add("flow", result.totalFlow);
+        reply.Add("min_cut", result.minCutPipes);
+    }
+
+    static bool Tokenize(const string& text, vector<string>& tokens, string& error) {
+        size_t i = 0;
+        while (i < text.size()) {
+            char ch = text[i];
+            if (ch == '#') break;
+            if (isspace((unsigned char)ch)) { i++; continue; }
+            string token;
+            if (ch == '"') {
+                size_t close = ++i;
+                while (close < text.size() && text[close] != '"') {
+                    if (text[close] == '\\' && close + 1 < text.size()) close++;
+                    token += text[close++];
+                }
+                if (close == text.size()) {
+                    error = "unterminated quote";
+                    return false;
+                }
+                i = close + 1;
+            } else {
+                while (i < text.size() && !isspace((unsigned char)text[i])) token += text[i++];
+            }
+            tokens.push_back(move(token));
+        }
+        return true;
+    }
+
+private:
+    void Write(ostream& out, const BatchReply& reply, const string& command, size_t line, double micros, const string& output) {
+        if (json) reply.WriteJson(out, command, line, micros, output);
+        else reply.WriteText(out, command, line, output);
+    }
+
+    void Register(const string& name, const string& usage, Handler handler) {
+        commands[name] = {usage, move(handler)};
+    }
+
+    static bool SplitFilter(BatchArgs& args, size_t i, string& key, string& value) {
+        string token = args.Str(i);
+        size_t eq = token.find('=');
+        if (eq == string::npos || eq == 0) {
+            args.Fail("expected field=value: " + token);
+            return false;
+        }
+        key = token.substr(0, eq);
+        value = token.substr(eq + 1);
+        return true;
+    }
+
+    // "MIN..MAX"
+    static bool ParseRange(BatchArgs& field, double& lo, double& hi) {
+        string text = field.Str(0);
+        size_t dots = text.find("..");
+        if (dots == string::npos) {
+            field.Fail("expected MIN..MAX");
+            return false;
+        }
+        BatchArgs bounds({text.substr(0, dots), text.substr(dots + 2)});
+        lo = bounds.Double(0);
+        hi = bounds.Double(1);
+        if (!bounds.Error().empty()) field.Fail(bounds.Error());
+        return bounds.Error().empty();
+    }
+
+    template<typename T, typename Manager>
+    void Find(const vector<Query<T, Manager>>& conditions, const Manager& manager, BatchReply& reply) {
+        Query<T, Manager> query = conditions[0];
+        for (size_t i = 1; i < conditions.size(); i++) query = query && conditions[i];
+        QueryCursor<T> cursor = queryPlanner.Run(query, manager, "BATCH");
+        vector<int> ids;
+        ids.reserve(cursor.Count());
+        while (const T* item = cursor.Next()) ids.push_back(item->id);
+        reply.Add("count", ids.size());
+        reply.Add("ids", ids);
+    }
+
+    static PathAlgorithm ParsePathAlgorithm(BatchArgs& args, size_t i) {
+        string name = args.Str(i);
+        if (name.empty() || name == "dijkstra") return PathAlgorithm::Dijkstra;
+        if (name == "bidirectional") return PathAlgorithm::Bidirectional;
+        if (name == "alt") return PathAlgorithm::ALT;
+        if (name == "ch") return PathAlgorithm::ContractionHierarchy;
+        args.Fail("unknown path algorithm: " + name);
+        return PathAlgorithm::Dijkstra;
+    }
+
+    static MaxFlowAlgorithm ParseFlowAlgorithm(BatchArgs& args, size_t i) {
+        string name = args.Str(i);
+        if (name.empty() || name == "dinic") return MaxFlowAlgorithm::Dinic;
+        if (name == "push-relabel") return MaxFlowAlgorithm::PushRelabel;
+        args.Fail("unknown flow algorithm: " + name);
+        return MaxFlowAlgorithm::Dinic;
+    }
+
+    void RegisterCommands() {
+        Register("help", "help", [this](BatchArgs&, BatchReply& reply) {
+            for (const auto& command : commands) reply.Add(command.first, command.second.first);
+        });
+
+        Register("add-pipe", "add-pipe " + string(PIPE_FIELDS), [this](BatchArgs& args, BatchReply& reply) {
+            Pipe pipe;
+            if (!args.Expect(3, 4, commands["add-pipe"].first) || !ReadPipe(args, pipe)) return;
+            reply.Add("id", pipeManager.Emplace(move(pipe)).id);
+        });
+
+        // Импорт труб из файла: строка - аргументы add-pipe. Все строки проверяются до вставки,
+        // затем трубы добавляются одним блоком id
+        Register("add-pipes", "add-pipes <file>", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(1, 1, commands["add-pipes"].first)) return;
+            ifstream in(args.Str(0));
+            if (!in) return reply.Fail("cannot open " + args.Str(0));
+            vector<Pipe> batch;
+            string text;
+            for (size_t line = 1; getline(in, text); line++) {
+                vector<string> tokens;
+                string error;
+                if (!Tokenize(text, tokens, error)) return reply.Fail("line " + to_string(line) + ": " + error);
+                if (tokens.empty()) continue;
+                BatchArgs fields(move(tokens));
+                Pipe pipe;
+                if (!fields.Expect(3, 4, PIPE_FIELDS) || !ReadPipe(fields, pipe)) {
+                    return reply.Fail("line " + to_string(line) + ": " + fields.Error());
+                }
+                batch.push_back(move(pipe));
+            }
+            if (batch.empty()) return reply.Fail("no pipes in " + args.Str(0));
+            size_t count = batch.size();
+            reply.Add("first", pipeManager.AddRange(move(batch)));
+            reply.Add("count", count);
+        });
+
+        Register("add-cs", "add-cs <name> <workshops> <working> <class> [status 0|1]", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(4, 5, commands["add-cs"].first)) return;
+            Compress station = {};
+            station.name = args.Str(0);
+            station.workshop_count = args.Int(1);
+            station.workshop_working = args.Int(2);
+            station.classification = args.Str(3);
+            station.working = !args.Has(4) || args.Flag(4);
+            if (!args.Error().empty()) return;
+            if (station.workshop_working < 0 || station.workshop_working > station.workshop_count) {
+                return reply.Fail("working workshops must be within 0..workshops");
+            }
+            reply.Add("id", compressManager.Emplace(move(station)).id);
+        });
+
+        Register("link", "link <pipe> <from_cs> <to_cs>", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(3, 3, commands["link"].first)) return;
+            int pipeId = args.Int(0), from = args.Int(1), to = args.Int(2);
+            if (!args.Error().empty()) return;
+            if (!CheckLink(pipeId, from, to, reply)) return;
+            pipeManager.LinkPipe(pipeId, from, to);
+            reply.Add("pipe", pipeId);
+        });
+
+        // Как пункт меню: свободная труба нужного диаметра, иначе новая (если задана длина)
+        Register("connect", "connect <from_cs> <to_cs> <diameter> [length_for_new_pipe]", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(3, 4, commands["connect"].first)) return;
+            int from = args.Int(0), to = args.Int(1), diameter = args.Int(2);
+            double length = args.Has(3) ? args.Double(3) : 0;
+            if (!args.Error().empty()) return;
+            if (!PipeManager::IsAllowedDiameter(diameter)) return reply.Fail(DIAMETER_ERROR);
+            // Станции проверяются до создания трубы, чтобы при ошибке не оставалось лишней
+            if (!CheckStations(from, to, reply)) return;
+            int pipeId = pipeManager.FindFreePipeID(diameter);
+            bool created = false;
+            if (pipeId == -1) {
+                if (length <= 0) return reply.Fail("no free pipe with diameter " + to_string(diameter));
+                Pipe pipe = {};
+                pipe.km_mark = "CS" + to_string(from) + "-CS" + to_string(to);
+                pipe.length = length;
+                pipe.diametr = diameter;
+                pipeId = pipeManager.Emplace(move(pipe)).id;
+                created = true;
+            }
+            if (!CheckLink(pipeId, from, to, reply)) return;
+            pipeManager.LinkPipe(pipeId, from, to);
+            reply.Add("pipe", pipeId);
+            reply.Add("created", created);
+        });
+
+        Register("unlink", "unlink <pipe>", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(1, 1, commands["unlink"].first)) return;
+            int pipeId = args.Int(0);
+            if (!args.Error().empty()) return;
+            if (!pipeManager.FindById(pipeId)) return reply.Fail("pipe not found");
+            networkManager.DisconnectPipe(pipeId);
+        });
+
+        Register("repair", "repair <pipe> <0|1>", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(2, 2, commands["repair"].first)) return;
+            int pipeId = args.Int(0);
+            bool repair = args.Flag(1);
+            if (!args.Error().empty()) return;
+            if (!pipeManager.SetRepair(pipeId, repair)) reply.Fail("pipe not found");
+        });
+
+        Register("delete-pipe", "delete-pipe <pipe>", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(1, 1, commands["delete-pipe"].first)) return;
+            int pipeId = args.Int(0);
+            if (args.Error().empty() && !pipeManager.Delete(pipeId)) reply.Fail("pipe not found");
+        });
+
+        Register("delete-cs", "delete-cs <cs>", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(1, 1, commands["delete-cs"].first)) return;
+            int stationId = args.Int(0);
+            if (args.Error().empty() && !compressManager.Delete(stationId)) reply.Fail("CS not found");
+        });
+
+        Register("path", PATH_USAGE, [this](BatchArgs& args, BatchReply& reply) { ShortestPath(networkManager, args, reply); });
+        Register("maxflow", FLOW_USAGE, [this](BatchArgs& args, BatchReply& reply) { MaxFlow(networkManager, args, reply); });
+
+        // Составной поиск: условия field=value объединяются через AND
+        Register("find-pipes", "find-pipes [diameter=N] [repair=0|1] [length=MIN..MAX] [km=TEXT] [class=TEXT]",
+                 [this](BatchArgs& args, BatchReply& reply) {
+            vector<PipeQuery> conditions;
+            for (size_t i = 0; i < args.Count() && args.Error().empty(); i++) {
+                string key, value;
+                if (!SplitFilter(args, i, key, value)) break;
+                BatchArgs field({value});
+                double lo, hi;
+                if (key == "diameter") conditions.push_back(PipeWhere::Diameter(field.Int(0)));
+                else if (key == "repair") conditions.push_back(PipeWhere::Repair(field.Flag(0)));
+                else if (key == "length" && ParseRange(field, lo, hi)) conditions.push_back(PipeWhere::Length(lo, hi));
+                else if (key == "km") conditions.push_back(PipeWhere::KmMark(value));
+                else if (key == "class") conditions.push_back(PipeWhere::LinkedTo(compressManager, CompressWhere::Classification(value)));
+                else if (key != "length") args.Fail("unknown filter: " + key);
+                if (!field.Error().empty()) args.Fail(key + ": " + field.Error());
+            }
+            if (!args.Error().empty()) return;
+            if (conditions.empty()) return reply.Fail("usage: " + commands["find-pipes"].first);
+            Find(conditions, pipeManager, reply);
+        });
+
+        Register("find-cs", "find-cs [name=TEXT] [class=TEXT] [working=0|1] [load=MIN..MAX]",
+                 [this](BatchArgs& args, BatchReply& reply) {
+            vector<CompressQuery> conditions;
+            for (size_t i = 0; i < args.Count() && args.Error().empty(); i++) {
+                string key, value;
+                if (!SplitFilter(args, i, key, value)) break;
+                BatchArgs field({value});
+                double lo, hi;
+                if (key == "name") conditions.push_back(CompressWhere::Name(value));
+                else if (key == "class") conditions.push_back(CompressWhere::Classification(value));
+                else if (key == "working") conditions.push_back(CompressWhere::Working(field.Flag(0)));
+                else if (key == "load" && ParseRange(field, lo, hi)) conditions.push_back(CompressWhere::WorkshopPercentage(lo, hi));
+                else if (key != "load") args.Fail("unknown filter: " + key);
+                if (!field.Error().empty()) args.Fail(key + ": " + field.Error());
+            }
+            if (!args.Error().empty()) return;
+            if (conditions.empty()) return reply.Fail("usage: " + commands["find-cs"].first);
+            Find(conditions, compressManager, reply);
+        });
+
+        Register("topo", "topo", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(0, 0, commands["topo"].first)) return;
+            TopologicalSortResult result = networkManager.TopologicalSort();
+            if (result.HasCycle()) {
+                reply.Add("cycle", result.cyclePipes);
+                return reply.Fail("network has a cycle");
+            }
+            reply.Add("order", result.order);
+        });
+
+        Register("stats", "stats", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(0, 0, commands["stats"].first)) return;
+            const NetworkGraph& g = networkManager.GetGraph();
+            reply.Add("pipes", pipeManager.GetAll().size());
+            reply.Add("stations", compressManager.GetAll().size());
+            reply.Add("edges", g.EdgeCount());
+            reply.Add("vertices", g.VertexCount());
+        });
+
+        // Масштабирование матрицы расстояний по всем КС: время на каждое число потоков
+        Register("bench-matrix", "bench-matrix [threads...]", [this](BatchArgs& args, BatchReply& reply) {
+            vector<int> counts;
+            for (size_t i = 0; i < args.Count(); i++) {
+                counts.push_back(args.Int(i));
+                if (counts.back() <= 0) args.Fail("thread count must be positive");
+            }
+            if (!args.Error().empty()) return;
+            if (counts.empty()) counts = NetworkManager::BenchmarkThreadCounts();
+            vector<int> ids;
+            for (const auto& station : compressManager.GetAll()) ids.push_back(station.id);
+            if (ids.empty()) return reply.Fail("no CS");
+            vector<double> times = networkManager.BenchmarkDistanceMatrix(ids, counts, taskTimings.Hook());
+            vector<double> speedup;
+            for (double ms : times) speedup.push_back(ms > 0 ? times[0] / ms : 0.0);
+            reply.Add("sources", ids.size());
+            reply.Add("threads", counts);
+            reply.Add("ms", times);
+            reply.Add("speedup", speedup);
+            logger.Log("BENCHMARK distance matrix - sources: " + to_string(ids.size()));
+        });
+
+        // Перекрестная проверка движков на случайных сетях; рабочие данные не затрагиваются
+        Register("selfcheck", "selfcheck [rounds] [seed]", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(0, 2, commands["selfcheck"].first)) return;
+            int rounds = args.Has(0) ? args.Int(0) : 20;
+            int seed = args.Has(1) ? args.Int(1) : 1;
+            if (!args.Error().empty()) return;
+            if (rounds <= 0) return reply.Fail("rounds must be positive");
+            SelfCheck check((unsigned)seed);
+            check.Run(rounds);
+            for (const string& failure : check.Failures()) cout << "FAILED: " << failure << "\n";
+            reply.Add("checks", check.Checks());
+            reply.Add("failed", check.Failures().size());
+            if (!check.Failures().empty()) reply.Fail(check.Failures()[0]);
+            logger.Log("SELFCHECK - checks: " + to_string(check.Checks()) + ", failed: " + to_string(check.Failures().size()));
+        });
+
+        Register("save", "save [text|snapshot|journal] [file]", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(0, 2, commands["save"].first)) return;
+            string format = args.Has(0) ? args.Str(0) : "text";
+            string file = args.Str(1);
+            string error;
+            if (format == "text") error = fileManager.SaveAllData(pipeManager, compressManager, file);
+            else if (format == "snapshot") error = fileManager.SaveSnapshot(pipeManager, compressManager, file);
+            else if (format == "journal" && file.empty()) error = fileManager.SaveIncremental(pipeManager, compressManager);
+            else error = "usage: " + commands["save"].first + " (journal has no file argument)";
+            if (!error.empty()) reply.Fail(error);
+        });
+
+        Register("load", "load [file]", [this](BatchArgs& args, BatchReply& reply) {
+            if (!args.Expect(0, 1, commands["load"].first)) return;
+            string error = fileManager.LoadAllData(pipeManager, compressManager, nextPipeId, nextCompressId, args.Str(0));
+            if (!error.empty()) reply.Fail(error);
+            reply.Add("pipes", pipeManager.GetAll().size());
+            reply.Add("stations", compressManager.GetAll().size());
+        });
+    }
+
+    static constexpr const char* DIAMETER_ERROR = "diameter must be 500, 700, 1000 or 1400";
+    static constexpr const char* PIPE_FIELDS = "<km_mark> <length> <diameter> [repair 0|1]";
+
+    // Поля новой трубы из аргументов PIPE_FIELDS; ошибка остается в args
+    static bool ReadPipe(BatchArgs& args, Pipe& pipe) {
+        pipe = {};
+        pipe.km_mark = args.Str(0);
+        pipe.length = args.Double(1);
+        pipe.diametr = args.Int(2);
+        pipe.repair = args.Has(3) && args.Flag(3);
+        if (!args.Error().empty()) return false;
+        if (pipe.length <= 0) args.Fail("length must be positive");
+        else if (!PipeManager::IsAllowedDiameter(pipe.diametr)) args.Fail(DIAMETER_ERROR);
+        return args.Error().empty();
+    }
+
+    bool CheckStations(int from, int to, BatchReply& reply) {
+        if (from == to) reply.Fail("loops not allowed");
+        else if (!compressManager.FindById(from) || !compressManager.FindById(to)) reply.Fail("CS not found");
+        return reply.Ok();
+    }
+
+    bool CheckLink(int pipeId, int from, int to, BatchReply& reply) {
+        if (!CheckStations(from, to, reply)) return false;
+        if (!pipeManager.FindById(pipeId)) reply.Fail("pipe not found");
+        return reply.Ok();
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef COMPRESS_COLUMNS_H
+#define COMPRESS_COLUMNS_H
+
+#include "structs.h"
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Колоночное зеркало КС для числовых фильтров; позиция i совпадает со слотом станции в CompressManager
+struct CompressColumns {
+    vector<int> id;
+    vector<int> workshopCount;
+    vector<int> workshopWorking;
+    vector<uint64_t> workingBits;    // признак работы, бит на станцию
+
+    size_t Size() const { return id.size(); }
+
+    bool Working(size_t i) const { return (workingBits[i >> 6] >> (i & 63)) & 1; }
+
+    void SetWorking(size_t i, bool value) {
+        uint64_t mask = uint64_t(1) << (i & 63);
+        if (value) workingBits[i >> 6] |= mask;
+        else workingBits[i >> 6] &= ~mask;
+    }
+
+    void Reserve(size_t count) {
+        id.reserve(count);
+        workshopCount.reserve(count);
+        workshopWorking.reserve(count);
+        workingBits.reserve((count + 63) / 64);
+    }
+
+    void Clear() {
+        id.clear();
+        workshopCount.clear();
+        workshopWorking.clear();
+        workingBits.clear();
+    }
+
+    void Append(const Compress& station) {
+        size_t i = id.size();
+        id.push_back(station.id);
+        workshopCount.push_back(station.workshop_count);
+        workshopWorking.push_back(station.workshop_working);
+        if ((i >> 6) >= workingBits.size()) workingBits.push_back(0);
+        SetWorking(i, station.working);
+    }
+
+    void Set(size_t i, const Compress& station) {
+        workshopCount[i] = station.workshop_count;
+        workshopWorking[i] = station.workshop_working;
+        SetWorking(i, station.working);
+    }
+
+    // Строка удаленной станции: цехов нет, не работает
+    void ClearRow(size_t i) {
+        id[i] = 0;
+        workshopCount[i] = 0;
+        workshopWorking[i] = 0;
+        SetWorking(i, false);
+    }
+};
+
+#endif
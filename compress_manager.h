@@ -3,15 +3,83 @@
 
 #include "structs.h"
 #include "generic_manager.h"
+#include "compress_columns.h"
+#include "secondary_index.h"
 #include <sstream>
 
 using namespace std;
 
 class CompressManager : public GenericManager<Compress> {
+private:
+    // Колоночное зеркало для числовых фильтров (включается по требованию)
+    CompressColumns columns;
+    bool columnsEnabled = false;
+    // Вторичные индексы для поиска (включаются по требованию)
+    CompressIndexes indexes;
+    bool indexesEnabled = false;
+
 public:
     CompressManager(int& id, Logger& log) : GenericManager<Compress>(id, log) {}
 
+    void EnableColumns() {
+        if (columnsEnabled) return;
+        RebuildColumns();
+        columnsEnabled = true;
+    }
+
+    // nullptr, если колонки не включены
+    const CompressColumns* Columns() const { return columnsEnabled ? &columns : nullptr; }
+
+    // Включение индексов по загрузке цехов, статусу работы, названию и классу
+    void EnableIndexes() {
+        if (indexesEnabled) return;
+        indexes.Clear();
+        for (const auto& station : GetAll()) indexes.Insert(station);
+        indexesEnabled = true;
+    }
+
+    // nullptr, если индексы не включены
+    const CompressIndexes* Indexes() const { return indexesEnabled ? &indexes : nullptr; }
+
 private:
+    void OnInsert(const Compress& station) override {
+        if (columnsEnabled) columns.Append(station);
+        if (indexesEnabled) indexes.Insert(station);
+    }
+
+    void OnErase(const Compress& station) override {
+        if (columnsEnabled) columns.ClearRow((size_t)SlotOf(station.id));
+        if (indexesEnabled) indexes.Erase(station);
+    }
+
+    void OnEdit(const Compress& before, const Compress& after) override {
+        if (columnsEnabled) columns.Set((size_t)SlotOf(after.id), after);
+        if (indexesEnabled) indexes.Update(before, after);
+    }
+
+    void OnClear() override {
+        columns.Clear();
+        indexes.Clear();
+    }
+
+    void OnReserve(size_t count) override {
+        if (columnsEnabled) columns.Reserve(count);
+    }
+
+    void OnCompact() override {
+        if (columnsEnabled) RebuildColumns();
+    }
+
+    // Строки колонок по всем слотам, включая пустые
+    void RebuildColumns() {
+        columns.Clear();
+        columns.Reserve(items.size());
+        for (size_t slot = 0; slot < items.size(); slot++) {
+            columns.Append(items[slot]);
+            if (!live.Test(slot)) columns.ClearRow(slot);
+        }
+    }
+
     void OnAdd(const Compress& station) override {
         stringstream ss;
         ss << "ADDED CS - ID: " << station.id << ", Name: " << station.name 
@@ -22,6 +90,12 @@ private:
         logger.Log(ss.str());
     }
 
+    void OnAddRange(int firstId, size_t count) override {
+        stringstream ss;
+        ss << "ADDED CS (BATCH) - IDs: " << firstId << "-" << firstId + (int)count - 1 << ", Count: " << count;
+        logger.Log(ss.str());
+    }
+
     void OnDelete(const Compress& station) override {
         stringstream ss;
         ss << "DELETED CS - ID: " << station.id << ", Name: " << station.name 
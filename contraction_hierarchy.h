@@ -0,0 +1,441 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include "network_graph.h"
+#include "shortest_path.h"
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <climits>
+
+using namespace std;
+
+// Иерархия сжатия (contraction hierarchy) в "настраиваемом" варианте:
+// порядок вершин и набор ребер-шорткатов зависят только от структуры сети,
+// а веса (длины труб, ремонт) накладываются отдельным шагом настройки.
+// Поэтому переключение признака ремонта пересчитывает только затронутые шорткаты.
+//
+// Каждое ребро иерархии {u, v} хранится у вершины с меньшим рангом u:
+// upWeight - вес u -> v, downWeight - вес v -> u.
+class ContractionHierarchy {
+private:
+    static constexpr double INF = numeric_limits<double>::infinity();
+    // Бюджет ребер иерархии: на дорожных и сеточных сетях их в 10-15 раз больше, чем ребер
+    // графа, а на случайных (без малых разделителей) заполнение почти квадратичное
+    static constexpr size_t SHORTCUT_BUDGET_FACTOR = 32;
+    static constexpr size_t SHORTCUT_BUDGET_MIN = size_t(1) << 16;
+
+    int n = 0;
+    bool ready = false;
+    size_t shortcutBudget = 0;
+    vector<int> rank;
+    vector<int> treeParent;                // дерево исключения: младший по рангу старший сосед
+
+    // Ребра вверх: у вершины u - соседи с большим рангом, отсортированы по индексу
+    vector<int> upStart;
+    vector<int> upTarget;
+    // Ребра вниз: у вершины v - соседи с меньшим рангом и номер ребра
+    vector<int> downStart;
+    vector<int> downSource;
+    vector<int> downEdge;
+
+    vector<double> upWeight, downWeight;
+    vector<int> upVia, downVia;            // средняя вершина шортката, -1 для исходного ребра
+    vector<int> upGraphEdge, downGraphEdge; // ребро графа сети для исходных ребер
+
+    // Веса исходных ребер (минимум по параллельным трубам вне ремонта)
+    vector<double> inputUp, inputDown;
+    vector<int> inputUpEdge, inputDownEdge;
+
+    // Буферы запроса
+    vector<double> dist[2];
+    vector<int> parent[2];                 // предыдущая вершина в поиске
+    vector<int> touched;
+    vector<char> updateQueued;
+
+public:
+    bool Empty() const { return n == 0; }
+    size_t ShortcutCount() const { return upTarget.size(); }
+    // false, если при построении ребер оказалось больше бюджета: запросы недоступны
+    bool Ready() const { return ready; }
+    size_t ShortcutBudget() const { return shortcutBudget; }
+
+    // false, если иерархия превысила бюджет ребер; тогда она остается пустой
+    bool Build(const NetworkGraph& g) {
+        n = g.VertexCount();
+        shortcutBudget = min((size_t)INT_MAX, max(SHORTCUT_BUDGET_MIN, SHORTCUT_BUDGET_FACTOR * (size_t)g.EdgeCount()));
+        ready = ComputeOrder(g);
+        if (!ready) {
+            Release();
+            return false;
+        }
+        Customize(g);
+        for (int side = 0; side < 2; side++) {
+            dist[side].assign(n, INF);
+            parent[side].assign(n, -1);
+        }
+        touched.clear();
+        return true;
+    }
+
+    // Полная настройка весов
+    void Customize(const NetworkGraph& g) {
+        size_t m = upTarget.size();
+        inputUp.assign(m, INF); inputDown.assign(m, INF);
+        inputUpEdge.assign(m, -1); inputDownEdge.assign(m, -1);
+        for (int e = 0; e < g.EdgeCount(); e++) {
+            if (g.edgeRepair[e]) continue;
+            ApplyInput(g, e);
+        }
+
+        upWeight = inputUp; downWeight = inputDown;
+        upVia.assign(m, -1); downVia.assign(m, -1);
+        upGraphEdge = inputUpEdge; downGraphEdge = inputDownEdge;
+
+        // Вершины в порядке возрастания ранга: нижние треугольники уже посчитаны
+        vector<int> byRank(n);
+        for (int v = 0; v < n; v++) byRank[rank[v]] = v;
+        for (int u : byRank) {
+            for (int i = upStart[u]; i < upStart[u + 1]; i++) {
+                for (int j = upStart[u]; j < upStart[u + 1]; j++) {
+                    if (i == j) continue;
+                    int v = upTarget[i], w = upTarget[j];
+                    if (rank[v] > rank[w]) continue;
+                    // Треугольник u < v < w: ребро {v, w} через u
+                    int e = FindEdge(v, w);
+                    double vw = downWeight[i] + upWeight[j];   // v -> u -> w
+                    double wv = downWeight[j] + upWeight[i];   // w -> u -> v
+                    if (vw < upWeight[e]) { upWeight[e] = vw; upVia[e] = u; upGraphEdge[e] = -1; }
+                    if (wv < downWeight[e]) { downWeight[e] = wv; downVia[e] = u; downGraphEdge[e] = -1; }
+                }
+            }
+        }
+    }
+
+    // Инкрементальная настройка после изменения ремонта одного ребра графа
+    void UpdateGraphEdge(const NetworkGraph& g, int graphEdge) {
+        int a = g.edgeFrom[graphEdge], b = g.edgeTo[graphEdge];
+        int lo = rank[a] < rank[b] ? a : b;
+        int hi = lo == a ? b : a;
+        int e = FindEdge(lo, hi);
+
+        // Пересчитываем вход ребра {a, b} по всем параллельным трубам в обе стороны
+        inputUp[e] = inputDown[e] = INF;
+        inputUpEdge[e] = inputDownEdge[e] = -1;
+        for (int x = g.outStart[a]; x < g.outStart[a + 1]; x++) {
+            if (g.edgeTo[x] == b && !g.edgeRepair[x]) ApplyInput(g, x);
+        }
+        for (int x = g.outStart[b]; x < g.outStart[b + 1]; x++) {
+            if (g.edgeTo[x] == a && !g.edgeRepair[x]) ApplyInput(g, x);
+        }
+
+        // Очередь ребер по рангу нижней вершины: каждое пересчитывается целиком,
+        // при изменении веса в очередь попадают ребра, использующие его в треугольнике
+        auto lowerRank = [&](int edge) { return rank[EdgeLow(edge)]; };
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> work;
+        vector<char>& queued = updateQueued;
+        queued.resize(upTarget.size(), 0);
+        work.push({lowerRank(e), e});
+        queued[e] = 1;
+
+        while (!work.empty()) {
+            int cur = work.top().second;
+            work.pop();
+            queued[cur] = 0;
+            if (!Recompute(cur)) continue;
+
+            // Ребро {v, w} с нижней вершиной v входит в треугольники {v, w, y} для y из up(v)
+            int v = EdgeLow(cur), w = upTarget[cur];
+            for (int i = upStart[v]; i < upStart[v + 1]; i++) {
+                int y = upTarget[i];
+                if (y == w) continue;
+                int dep = rank[w] < rank[y] ? FindEdge(w, y) : FindEdge(y, w);
+                if (!queued[dep]) { queued[dep] = 1; work.push({lowerRank(dep), dep}); }
+            }
+        }
+    }
+
+    // Запрос: подъем от s и от t по дереву исключения. Все вершины, достижимые вверх по
+    // иерархии, - предки в этом дереве, а предки обрабатываются в порядке ранга,
+    // поэтому очередь с приоритетом не нужна.
+    void Query(const NetworkGraph& g, int s, int t, ShortestPathResult& result) {
+        for (int v : touched) {
+            for (int side = 0; side < 2; side++) { dist[side][v] = INF; parent[side][v] = -1; }
+        }
+        touched.clear();
+
+        dist[0][s] = 0;
+        dist[1][t] = 0;
+        for (int side = 0; side < 2; side++) {
+            for (int u = side == 0 ? s : t; u != -1; u = treeParent[u]) {
+                if (side == 0) touched.push_back(u);
+                else if (dist[0][u] == INF) touched.push_back(u);
+                result.settled++;
+                double d = dist[side][u];
+                if (d == INF) continue;
+                for (int i = upStart[u]; i < upStart[u + 1]; i++) {
+                    double w = side == 0 ? upWeight[i] : downWeight[i];
+                    int v = upTarget[i];
+                    if (d + w < dist[side][v]) {
+                        dist[side][v] = d + w;
+                        parent[side][v] = u;
+                    }
+                }
+            }
+        }
+
+        // Встреча - общий предок s и t с минимальной суммой
+        double best = INF;
+        int meet = -1;
+        for (int u = t; u != -1; u = treeParent[u]) {
+            if (dist[0][u] + dist[1][u] < best) {
+                best = dist[0][u] + dist[1][u];
+                meet = u;
+            }
+        }
+
+        result.found = best != INF;
+        if (!result.found) return;
+        result.length = best;
+
+        // Цепочка вершин иерархии s -> meet -> t, затем распаковка шорткатов
+        vector<int> chain;
+        for (int v = meet; v != -1; v = parent[0][v]) chain.push_back(v);
+        reverse(chain.begin(), chain.end());
+        for (int v = parent[1][meet]; v != -1; v = parent[1][v]) chain.push_back(v);
+
+        vector<int> edges;
+        for (size_t i = 0; i + 1 < chain.size(); i++) Unpack(chain[i], chain[i + 1], edges);
+
+        result.stations.push_back(g.stationIds[s]);
+        for (int e : edges) {
+            result.pipes.push_back(g.edgePipe[e]);
+            result.stations.push_back(g.stationIds[g.edgeTo[e]]);
+        }
+    }
+
+private:
+    // Порядок сжатия - вложенные сечения: подграф делится "средним" слоем BFS,
+    // вершины разделителя получают старшие ранги, части упорядочиваются так же.
+    // Затем все шорткаты находятся символьным исключением вершин по рангу
+    // (без поиска свидетелей - иначе веса нельзя было бы менять).
+    // false, если ребер иерархии больше shortcutBudget.
+    bool ComputeOrder(const NetworkGraph& g) {
+        vector<vector<int>> adj(n);
+        for (int e = 0; e < g.EdgeCount(); e++) {
+            int a = g.edgeFrom[e], b = g.edgeTo[e];
+            adj[a].push_back(b);
+            adj[b].push_back(a);
+        }
+        for (auto& list : adj) {
+            sort(list.begin(), list.end());
+            list.erase(unique(list.begin(), list.end()), list.end());
+        }
+
+        rank.assign(n, -1);
+        vector<int> stamp(n, -1);
+        vector<int> level(n, -1);
+        vector<int> queue;
+        int nextRank = n;
+        int stampId = 0;
+
+        // BFS внутри текущего подграфа (помеченного stampId) по еще не упорядоченным вершинам
+        auto bfs = [&](int root) {
+            queue.clear();
+            queue.push_back(root);
+            level[root] = 0;
+            for (size_t head = 0; head < queue.size(); head++) {
+                int u = queue[head];
+                for (int v : adj[u]) {
+                    if (stamp[v] == stampId && rank[v] == -1 && level[v] == -1) {
+                        level[v] = level[u] + 1;
+                        queue.push_back(v);
+                    }
+                }
+            }
+        };
+        auto resetLevels = [&]() { for (int v : queue) level[v] = -1; };
+
+        vector<vector<int>> work;
+        work.emplace_back();
+        for (int v = 0; v < n; v++) work.back().push_back(v);
+
+        while (!work.empty()) {
+            vector<int> part = move(work.back());
+            work.pop_back();
+            if (part.empty()) continue;
+            stampId++;
+            for (int v : part) stamp[v] = stampId;
+
+            // Компонента связности первой вершины; остальное - отдельная задача
+            bfs(part[0]);
+            if (queue.size() < part.size()) {
+                vector<int> rest;
+                for (int v : part) if (level[v] == -1) rest.push_back(v);
+                vector<int> component = queue;
+                resetLevels();
+                work.push_back(move(rest));
+                work.push_back(move(component));
+                continue;
+            }
+            if (part.size() <= 2) {
+                resetLevels();
+                for (int v : part) rank[v] = --nextRank;
+                continue;
+            }
+
+            // Псевдопериферийная вершина - самая дальняя от произвольной
+            int far = queue.back();
+            resetLevels();
+            bfs(far);
+
+            // Слой, на котором набирается половина вершин, становится разделителем
+            int separatorLevel = 0;
+            size_t half = part.size() / 2;
+            for (size_t i = 0; i < queue.size(); i++) {
+                if (i >= half) { separatorLevel = level[queue[i]]; break; }
+            }
+            vector<int> rest;
+            for (int v : queue) {
+                if (level[v] == separatorLevel) rank[v] = --nextRank;
+                else rest.push_back(v);
+            }
+            resetLevels();
+            work.push_back(move(rest));
+        }
+
+        // Символьное исключение: соседи исключаемой вершины с большим рангом
+        // передаются ее ближайшему (по рангу) старшему соседу
+        vector<int> byRank(n);
+        for (int v = 0; v < n; v++) byRank[rank[v]] = v;
+        vector<vector<int>> up(n);
+        treeParent.assign(n, -1);
+        for (int v = 0; v < n; v++) {
+            for (int x : adj[v]) if (rank[x] > rank[v]) up[v].push_back(x);
+        }
+        adj.clear();
+        size_t total = 0;
+        for (int v : byRank) {
+            sort(up[v].begin(), up[v].end());
+            up[v].erase(unique(up[v].begin(), up[v].end()), up[v].end());
+            // Исключение прерывается сразу: дальше заполнение только растет
+            total += up[v].size();
+            if (total > shortcutBudget) return false;
+            if (up[v].empty()) continue;
+            int p = up[v][0];
+            for (int x : up[v]) if (rank[x] < rank[p]) p = x;
+            for (int x : up[v]) if (x != p) up[p].push_back(x);
+            treeParent[v] = p;
+        }
+
+        // Сборка CSR ребер вверх и вниз
+        upStart.assign(n + 1, 0);
+        for (int v = 0; v < n; v++) upStart[v + 1] = upStart[v] + (int)up[v].size();
+        upTarget.resize(upStart[n]);
+        downStart.assign(n + 1, 0);
+        for (int v = 0; v < n; v++) {
+            copy(up[v].begin(), up[v].end(), upTarget.begin() + upStart[v]);
+            for (int w : up[v]) downStart[w + 1]++;
+        }
+        for (int v = 0; v < n; v++) downStart[v + 1] += downStart[v];
+        downSource.resize(upTarget.size());
+        downEdge.resize(upTarget.size());
+        vector<int> pos(downStart.begin(), downStart.end() - 1);
+        for (int v = 0; v < n; v++) {
+            for (int i = upStart[v]; i < upStart[v + 1]; i++) {
+                int w = upTarget[i];
+                downSource[pos[w]] = v;
+                downEdge[pos[w]] = i;
+                pos[w]++;
+            }
+        }
+        return true;
+    }
+
+    // Освобождение памяти после превышения бюджета
+    void Release() {
+        n = 0;
+        rank = {}; treeParent = {};
+        upStart = {}; upTarget = {};
+        downStart = {}; downSource = {}; downEdge = {};
+        upWeight = {}; downWeight = {};
+        upVia = {}; downVia = {};
+        upGraphEdge = {}; downGraphEdge = {};
+        inputUp = {}; inputDown = {};
+        inputUpEdge = {}; inputDownEdge = {};
+        for (int side = 0; side < 2; side++) { dist[side] = {}; parent[side] = {}; }
+        touched = {}; updateQueued = {};
+    }
+
+    // Ребро иерархии между lo и hi (ранг lo меньше ранга hi)
+    int FindEdge(int lo, int hi) const {
+        auto first = upTarget.begin() + upStart[lo];
+        auto last = upTarget.begin() + upStart[lo + 1];
+        return (int)(lower_bound(first, last, hi) - upTarget.begin());
+    }
+
+    int EdgeLow(int edge) const {
+        return (int)(upper_bound(upStart.begin(), upStart.end(), edge) - upStart.begin()) - 1;
+    }
+
+    void ApplyInput(const NetworkGraph& g, int graphEdge) {
+        int a = g.edgeFrom[graphEdge], b = g.edgeTo[graphEdge];
+        double w = g.edgeLength[graphEdge];
+        if (rank[a] < rank[b]) {
+            int e = FindEdge(a, b);
+            if (w < inputUp[e]) { inputUp[e] = w; inputUpEdge[e] = graphEdge; }
+        } else {
+            int e = FindEdge(b, a);
+            if (w < inputDown[e]) { inputDown[e] = w; inputDownEdge[e] = graphEdge; }
+        }
+    }
+
+    // Пересчет весов ребра по входу и нижним треугольникам; true, если вес изменился
+    bool Recompute(int e) {
+        int v = EdgeLow(e), w = upTarget[e];
+        double up = inputUp[e], down = inputDown[e];
+        int upMid = -1, downMid = -1;
+
+        // Общие нижние соседи v и w (списки отсортированы по индексу вершины)
+        for (int i = downStart[v], j = downStart[w]; i < downStart[v + 1]; i++) {
+            int x = downSource[i];
+            int xv = downEdge[i];
+            while (j < downStart[w + 1] && downSource[j] < x) j++;
+            if (j == downStart[w + 1]) break;
+            if (downSource[j] != x) continue;
+            int xw = downEdge[j];
+            if (downWeight[xv] + upWeight[xw] < up) { up = downWeight[xv] + upWeight[xw]; upMid = x; }
+            if (downWeight[xw] + upWeight[xv] < down) { down = downWeight[xw] + upWeight[xv]; downMid = x; }
+        }
+
+        bool changed = up != upWeight[e] || down != downWeight[e];
+        upWeight[e] = up; downWeight[e] = down;
+        upVia[e] = upMid; downVia[e] = downMid;
+        upGraphEdge[e] = upMid == -1 ? inputUpEdge[e] : -1;
+        downGraphEdge[e] = downMid == -1 ? inputDownEdge[e] : -1;
+        return changed;
+    }
+
+    // Распаковка перехода a -> b в последовательность ребер графа сети.
+    // Без рекурсии: вложенность шорткатов на длинных магистралях может быть большой.
+    void Unpack(int a, int b, vector<int>& edges) const {
+        vector<pair<int, int>> stack = {{a, b}};
+        while (!stack.empty()) {
+            int x = stack.back().first, y = stack.back().second;
+            stack.pop_back();
+            bool upward = rank[x] < rank[y];
+            int e = upward ? FindEdge(x, y) : FindEdge(y, x);
+            int via = upward ? upVia[e] : downVia[e];
+            if (via == -1) {
+                edges.push_back(upward ? upGraphEdge[e] : downGraphEdge[e]);
+            } else {
+                stack.push_back({via, y});
+                stack.push_back({x, via});
+            }
+        }
+    }
+};
+
+#endif
@@ -4,135 +4,396 @@
 #include "pipe_manager.h"
 #include "compress_manager.h"
 #include "logger.h"
+#include "snapshot_format.h"
+#include "text_parser.h"
+#include "journal.h"
+#include "task_scheduler.h"
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
 
 using namespace std;
 
 class FileManager {
 private:
     Logger& logger;
-    string backupFile;
+    string backupFile;     // текстовый формат
+    string snapshotFile;   // двоичный снимок
+
+    // Журнал изменений: полное сохранение в snapshotFile + дописываемый <snapshotFile>.journal
+    Journal journal;
+    bool journalBaseValid = false;   // snapshotFile соответствует состоянию до накопленных изменений
+    static constexpr uint64_t COMPACT_MIN_BYTES = 1 << 20;
+
+    // Потоки для разбора текстового файла (0 - по числу ядер, 1 - только потоковый разбор)
+    int loadThreads = 0;
+    static constexpr uint64_t PARALLEL_MIN_BYTES = 4 << 20;
 
 public:
-    FileManager(Logger& log, const string& filename = "data_backup.txt") 
-        : logger(log), backupFile(filename) {}
+    FileManager(Logger& log, const string& filename = "data_backup.txt", const string& snapshot = "data_backup.snap")
+        : logger(log), backupFile(filename), snapshotFile(snapshot) {}
+
+    // Подписка журнала на изменения менеджеров
+    void AttachJournal(PipeManager& pipeManager, CompressManager& compressManager) {
+        journal.Attach(pipeManager, compressManager);
+    }
+
+    void SetLoadThreads(int threads) { loadThreads = threads; }
 
-    void SaveAllData(const PipeManager& pipeManager, const CompressManager& compressManager, const string& customFilename = "") {
+    string JournalFile() const { return snapshotFile + ".journal"; }
+
+    // Сохранение только изменений с прошлого сохранения. Если журнал вырос относительно
+    // полного сохранения, он сжимается в новый двоичный снимок.
+    // Операции сохранения и загрузки возвращают пустую строку или текст ошибки.
+    string SaveIncremental(const PipeManager& pipeManager, const CompressManager& compressManager) {
+        if (!journalBaseValid) return SaveSnapshot(pipeManager, compressManager);
+
+        size_t records = journal.PendingRecords();
+        size_t bytes = journal.PendingBytes();
+        if (!journal.Commit(JournalFile())) return Failure("Could not write journal.");
+
+        uint64_t journalBytes = Journal::FileBytes(JournalFile());
+        if (journalBytes > max<uint64_t>(COMPACT_MIN_BYTES, Journal::FileBytes(snapshotFile) / 2)) {
+            cout << "Journal is " << journalBytes << " bytes, compacting.\n";
+            return SaveSnapshot(pipeManager, compressManager);
+        }
+        cout << "Journal: " << records << " changes appended (" << bytes << " bytes)\n";
+        logger.Log("SAVED JOURNAL - changes: " + to_string(records));
+        return "";
+    }
+
+    string SaveAllData(const PipeManager& pipeManager, const CompressManager& compressManager, const string& customFilename = "") {
         string filename = customFilename.empty() ? backupFile : customFilename;
         
         ofstream file(filename);
-        if (!file.is_open()) {
-            cout << "Error: Could not open file.\n";
-            return;
-        }
+        if (!file.is_open()) return Failure("Could not open file " + filename + ".");
 
         file << "===== DATA BACKUP =====\n\n";
         SavePipes(file, pipeManager.GetAll());
         SaveCompress(file, compressManager.GetAll());
 
+        // Журнал ведется относительно снимка, текстовое сохранение его не затрагивает
         file.close();
+        if (!file) return Failure("Could not write " + filename + ".");
         cout << "All data saved to " << filename << "\n";
         logger.Log("SAVED DATA to " + filename);
+        return "";
+    }
+
+    // Двоичный снимок: заголовок, таблицы записей фиксированной ширины и пул строк
+    string SaveSnapshot(const PipeManager& pipeManager, const CompressManager& compressManager, const string& customFilename = "") {
+        string filename = customFilename.empty() ? snapshotFile : customFilename;
+        ItemRange<Pipe> pipes = pipeManager.GetAll();
+        ItemRange<Compress> stations = compressManager.GetAll();
+
+        string pool;
+        auto addString = [&pool](const string& value) {
+            SnapshotString ref{(uint32_t)pool.size(), (uint32_t)value.size()};
+            pool += value;
+            return ref;
+        };
+
+        SnapshotHeader header = {};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.headerSize = sizeof(SnapshotHeader);
+        header.pipeRecordSize = sizeof(PipeRecord);
+        header.compressRecordSize = sizeof(CompressRecord);
+        header.pipeCount = pipes.size();
+        header.compressCount = stations.size();
+        header.pipeOffset = AlignSnapshot(sizeof(SnapshotHeader));
+        header.compressOffset = AlignSnapshot(header.pipeOffset + pipes.size() * sizeof(PipeRecord));
+        header.stringOffset = header.compressOffset + stations.size() * sizeof(CompressRecord);
+        header.nextPipeId = pipeManager.NextId();
+        header.nextCompressId = compressManager.NextId();
+
+        vector<PipeRecord> pipeRecords(pipes.size());
+        size_t i = 0;
+        for (const Pipe& p : pipes) {
+            PipeRecord& r = pipeRecords[i++];
+            r = {};
+            r.id = p.id;
+            r.diametr = p.diametr;
+            r.length = p.length;
+            r.source_cs_id = p.source_cs_id;
+            r.dest_cs_id = p.dest_cs_id;
+            r.km_mark = addString(p.km_mark);
+            r.repair = p.repair;
+        }
+
+        vector<CompressRecord> stationRecords(stations.size());
+        i = 0;
+        for (const Compress& c : stations) {
+            CompressRecord& r = stationRecords[i++];
+            r = {};
+            r.id = c.id;
+            r.workshop_count = c.workshop_count;
+            r.workshop_working = c.workshop_working;
+            r.working = c.working;
+            r.name = addString(c.name);
+            r.classification = addString(c.classification);
+        }
+        header.stringSize = pool.size();
+
+        // Запись во временный файл и замена: при сбое старый снимок остается целым
+        string tmpFile = filename + ".tmp";
+        ofstream file(tmpFile, ios::binary | ios::trunc);
+        if (!file.is_open()) return Failure("Could not open file " + tmpFile + ".");
+        static const char padding[8] = {};
+        file.write((const char*)&header, sizeof(header));
+        file.write(padding, header.pipeOffset - sizeof(header));
+        file.write((const char*)pipeRecords.data(), pipeRecords.size() * sizeof(PipeRecord));
+        file.write(padding, header.compressOffset - (header.pipeOffset + pipeRecords.size() * sizeof(PipeRecord)));
+        file.write((const char*)stationRecords.data(), stationRecords.size() * sizeof(CompressRecord));
+        file.write(pool.data(), pool.size());
+        file.close();
+        if (!file || rename(tmpFile.c_str(), filename.c_str()) != 0) return Failure("Could not write snapshot " + filename + ".");
+        if (filename == snapshotFile) ResetJournal();
+        cout << "Snapshot saved to " << filename << "\n";
+        logger.Log("SAVED SNAPSHOT to " + filename);
+        return "";
     }
 
-    void LoadAllData(PipeManager& pipeManager, CompressManager& compressManager, 
+    // Формат файла (текст или двоичный снимок) определяется по сигнатуре.
+    // Без имени загружается более свежий из текстового файла и снимка; к снимку затем
+    // применяется журнал изменений. Счетчики id берутся из заголовка снимка, для текста -
+    // за наибольшим загруженным id.
+    string LoadAllData(PipeManager& pipeManager, CompressManager& compressManager, 
                      int& nextPipeId, int& nextCompressId, const string& customFilename = "") {
-        string filename = customFilename.empty() ? backupFile : customFilename;
-        ifstream file(filename);
-        if (!file.is_open()) {
-            cout << "Error: File not found.\n";
-            return;
+        string filename = customFilename.empty() ? DefaultLoadFile() : customFilename;
+        int prevPipeId = nextPipeId, prevCompressId = nextCompressId;
+        nextPipeId = 1;   // Restore продвигает счетчики за загруженные id
+        nextCompressId = 1;
+        journal.Pause(true);
+        string error = LoadBase(pipeManager, compressManager, filename);
+        bool ok = error.empty();
+        if (ok && filename == snapshotFile) {
+            JournalReplayStats stats = journal.Replay(JournalFile(), pipeManager, compressManager);
+            if (!stats.error.empty()) cout << "Warning: journal " << JournalFile() << ": " << stats.error << "\n";
+            if (stats.records > 0) cout << "Journal replayed: " << stats.records << " changes.\n";
+            if (stats.tornBytes > 0) cout << "Warning: incomplete journal tail dropped (" << stats.tornBytes << " bytes).\n";
+        }
+        journal.Pause(false);
+        journal.DiscardPending();
+        journalBaseValid = ok && filename == snapshotFile;
+
+        // При ошибке часть данных могла остаться прежней: id не должны пойти по второму кругу
+        if (!ok) {
+            nextPipeId = max(nextPipeId, prevPipeId);
+            nextCompressId = max(nextCompressId, prevCompressId);
+        }
+        return error;
+    }
+
+private:
+    // Время изменения файла в наносекундах, 0 - файла нет
+    static int64_t ModifiedAt(const string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return 0;
+        return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    string DefaultLoadFile() const {
+        int64_t snapshot = ModifiedAt(snapshotFile);
+        if (snapshot == 0) return backupFile;
+        snapshot = max(snapshot, ModifiedAt(JournalFile()));
+        return ModifiedAt(backupFile) > snapshot ? backupFile : snapshotFile;
+    }
+
+    // Сообщение об ошибке пользователю; оно же возвращается как результат операции
+    static string Failure(const string& message) {
+        cout << "Error: " << message << "\n";
+        return message;
+    }
+
+    void ResetJournal() {
+        journalBaseValid = journal.Reset(JournalFile());
+        if (!journalBaseValid) cout << "Warning: Could not reset journal " << JournalFile() << ".\n";
+    }
+
+    string LoadBase(PipeManager& pipeManager, CompressManager& compressManager, const string& filename) {
+        ifstream file(filename, ios::binary);
+        if (!file.is_open()) return Failure("File " + filename + " not found.");
+
+        char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+        file.read(magic, sizeof(magic));
+        if (IsSnapshotMagic(magic, (size_t)file.gcount())) {
+            return LoadSnapshot(file, filename, pipeManager, compressManager);
+        }
+        file.seekg(0, ios::end);
+        uint64_t fileSize = (uint64_t)file.tellg();
+        file.clear();
+        file.seekg(0);
+
+        int threads = loadThreads > 0 ? loadThreads : (int)max(1u, thread::hardware_concurrency());
+        if (threads > 1 && fileSize >= PARALLEL_MIN_BYTES) {
+            return LoadTextParallel(file, fileSize, filename, threads, pipeManager, compressManager);
         }
 
         pipeManager.Clear();
         compressManager.Clear();
 
-        string line;
-        int maxPipeId = 0;
-        int maxStationId = 0;
+        // Записи передаются в менеджеры по мере разбора, без промежуточных копий
+        auto started = chrono::steady_clock::now();
+        size_t skipped = 0;
+        TextDataParser parser;
+        bool ok = parser.Parse(file,
+            [&](const Pipe& pipe) { if (!pipeManager.Restore(pipe)) skipped++; },
+            [&](const Compress& station) { if (!compressManager.Restore(station)) skipped++; });
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
 
-        Pipe currentPipe = {};
-        Compress currentStation = {};
-        bool inPipe = false;
-        bool inStation = false;
+        file.close();
 
-        // Простой парсер
-        while (getline(file, line)) {
-            if (line.find("===== PIPES DATA") != string::npos) {
-                // Если были накопленные данные - сохраняем
-                continue;
-            }
-            if (line.find("===== COMPRESSOR") != string::npos) {
-                if (inPipe && currentPipe.id > 0) pipeManager.Add(currentPipe);
-                inPipe = false; 
-                continue;
-            }
+        if (!ok) {
+            string error = Failure(filename + ", " + parser.Diagnostic());
+            cout << "Loaded before the error: " << pipeManager.GetAll().size() << " pipes, "
+                 << compressManager.GetAll().size() << " stations.\n";
+            logger.Log("LOAD FAILED from " + filename + " - " + parser.Diagnostic());
+            return error;
+        }
+        ReportTextLoad(filename, parser.BytesRead(), seconds, skipped, pipeManager, compressManager);
+        return "";
+    }
 
-            if (line.find("~~~") != string::npos) {
-                if (inPipe && currentPipe.id > 0) {
-                    pipeManager.Add(currentPipe);
-                    maxPipeId = max(maxPipeId, currentPipe.id);
-                    currentPipe = {};
-                    inPipe = false;
-                }
-                if (inStation && currentStation.id > 0) {
-                    compressManager.Add(currentStation);
-                    maxStationId = max(maxStationId, currentStation.id);
-                    currentStation = {};
-                    inStation = false;
-                }
-                continue;
-            }
+    // Параллельный разбор: файл делится по границам записей, участки разбираются
+    // задачами общего планировщика в свои векторы, затем все переносится в менеджеры одной вставкой.
+    // При ошибке текущие данные не меняются.
+    string LoadTextParallel(ifstream& file, uint64_t fileSize, const string& filename, int threads,
+                          PipeManager& pipeManager, CompressManager& compressManager) {
+        auto started = chrono::steady_clock::now();
+        string text(fileSize, '\0');
+        file.read(&text[0], text.size());
+        text.resize((size_t)file.gcount());
+        file.close();
 
-            if (line.empty()) continue;
+        vector<TextChunk> chunks = TextDataParser::SplitIntoChunks(text, threads);
+        size_t parts = chunks.size();
+        vector<vector<Pipe>> pipeParts(parts);
+        vector<vector<Compress>> stationParts(parts);
+        vector<TextDataParser> parsers(parts);
+        vector<char> results(parts, 0);
 
-            // Определяем, что парсим
-            if (line.find("ID: ") == 0) {
-                // Пытаемся понять, это ID трубы или КС, по контексту предыдущих строк или простой логике
-                // Здесь упростим: если мы еще не встретили уникальные поля трубы/КС, считаем по заголовкам секций (но тут простой вариант)
-                // Лучше полагаться на флаги секций, но для надежности добавим проверку полей.
-            }
-            
-            // Парсинг Труб
-            if (line.find("Length (km):") != string::npos || 
-                line.find("Diameter (mm):") != string::npos ||
-                line.find("From CS:") != string::npos) {
-                inPipe = true; inStation = false;
-            }
-            // Парсинг КС
-            if (line.find("Workshops:") != string::npos || line.find("Working:") != string::npos) {
-                inStation = true; inPipe = false;
+        TaskScheduler::Shared().ParallelFor(0, parts, 1, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; i++) {
+                string_view chunk(text.data() + chunks[i].begin, chunks[i].end - chunks[i].begin);
+                results[i] = parsers[i].ParseText(chunk, chunks[i].section,
+                    [&](const Pipe& pipe) { pipeParts[i].push_back(pipe); },
+                    [&](const Compress& station) { stationParts[i].push_back(station); });
             }
+        }, "parse-chunk");
+
+        for (size_t i = 0; i < parts; i++) {
+            if (results[i]) continue;
+            size_t lineOffset = count(text.begin(), text.begin() + chunks[i].begin, '\n');
+            string diagnostic = parsers[i].Diagnostic(lineOffset);
+            string error = Failure(filename + ", " + diagnostic);
+            cout << "Data unchanged.\n";
+            logger.Log("LOAD FAILED from " + filename + " - " + diagnostic);
+            return error;
+        }
 
-            if (inPipe || (!inStation && line.find("ID: ") == 0 && line.find("Name:") == string::npos)) {
-                 ParsePipeLine(line, currentPipe, inPipe);
-            } else {
-                 ParseCompressLine(line, currentStation, inStation);
+        pipeManager.Clear();
+        compressManager.Clear();
+        size_t skipped = pipeManager.RestoreBulk(pipeParts) + compressManager.RestoreBulk(stationParts);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        ReportTextLoad(filename, text.size(), seconds, skipped, pipeManager, compressManager);
+        cout << "Parsed in " << parts << " parts.\n";
+        return "";
+    }
+
+    void ReportTextLoad(const string& filename, size_t bytes, double seconds, size_t skipped,
+                        const PipeManager& pipeManager, const CompressManager& compressManager) {
+        if (skipped > 0) cout << "Warning: " << skipped << " records with duplicate IDs skipped.\n";
+
+        double megabytes = bytes / (1024.0 * 1024.0);
+        logger.Log("LOADED DATA from " + filename);
+        cout << "Data loaded: " << pipeManager.GetAll().size() << " pipes, "
+             << compressManager.GetAll().size() << " stations ("
+             << fixed << setprecision(2) << megabytes << " MB in " << seconds * 1000 << " ms, "
+             << (seconds > 0 ? megabytes / seconds : 0.0) << " MB/s)\n";
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+    }
+
+    string LoadSnapshot(ifstream& file, const string& filename, PipeManager& pipeManager, CompressManager& compressManager) {
+        // Файл читается целиком одним вызовом, затем проверяется до изменения данных
+        file.seekg(0, ios::end);
+        uint64_t fileSize = (uint64_t)file.tellg();
+        file.seekg(0);
+        vector<char> data(fileSize);
+        file.read(data.data(), data.size());
+
+        SnapshotHeader header = {};
+        string error;
+        if (!file || fileSize < sizeof(SnapshotHeader)) {
+            error = "snapshot is truncated";
+        } else {
+            memcpy(&header, data.data(), sizeof(header));
+            ValidateSnapshotHeader(header, fileSize, error);
+        }
+
+        const PipeRecord* pipeRecords = nullptr;
+        const CompressRecord* stationRecords = nullptr;
+        const char* pool = nullptr;
+        if (error.empty()) {
+            pipeRecords = (const PipeRecord*)(data.data() + header.pipeOffset);
+            stationRecords = (const CompressRecord*)(data.data() + header.compressOffset);
+            pool = data.data() + header.stringOffset;
+            for (uint64_t i = 0; i < header.pipeCount && error.empty(); i++) {
+                if (!SnapshotStringValid(pipeRecords[i].km_mark, header.stringSize)) error = "bad string reference";
+            }
+            for (uint64_t i = 0; i < header.compressCount && error.empty(); i++) {
+                if (!SnapshotStringValid(stationRecords[i].name, header.stringSize) ||
+                    !SnapshotStringValid(stationRecords[i].classification, header.stringSize)) error = "bad string reference";
             }
         }
-        
-        // Добавляем последние
-        if (inPipe && currentPipe.id > 0) {
-            pipeManager.Add(currentPipe);
-            maxPipeId = max(maxPipeId, currentPipe.id);
+        if (!error.empty()) return Failure("Corrupted snapshot " + filename + " (" + error + ").");
+
+        pipeManager.Clear();
+        compressManager.Clear();
+        pipeManager.Reserve(header.pipeCount);
+        compressManager.Reserve(header.compressCount);
+
+        size_t skipped = 0;
+        for (uint64_t i = 0; i < header.pipeCount; i++) {
+            const PipeRecord& r = pipeRecords[i];
+            Pipe pipe;
+            pipe.id = r.id;
+            pipe.km_mark.assign(pool + r.km_mark.offset, r.km_mark.length);
+            pipe.length = r.length;
+            pipe.diametr = r.diametr;
+            pipe.repair = r.repair != 0;
+            pipe.source_cs_id = r.source_cs_id;
+            pipe.dest_cs_id = r.dest_cs_id;
+            if (!pipeManager.Restore(pipe)) skipped++;
         }
-        if (inStation && currentStation.id > 0) {
-            compressManager.Add(currentStation);
-            maxStationId = max(maxStationId, currentStation.id);
+        for (uint64_t i = 0; i < header.compressCount; i++) {
+            const CompressRecord& r = stationRecords[i];
+            Compress station;
+            station.id = r.id;
+            station.name.assign(pool + r.name.offset, r.name.length);
+            station.workshop_count = r.workshop_count;
+            station.workshop_working = r.workshop_working;
+            station.classification.assign(pool + r.classification.offset, r.classification.length);
+            station.working = r.working != 0;
+            if (!compressManager.Restore(station)) skipped++;
         }
+        // Id удаленных в конце записей заново не выдаются
+        pipeManager.AdvanceNextId(header.nextPipeId);
+        compressManager.AdvanceNextId(header.nextCompressId);
 
-        nextPipeId = maxPipeId + 1;
-        nextCompressId = maxStationId + 1;
-        file.close();
-        logger.Log("LOADED DATA from " + filename);
-        cout << "Data loaded.\n";
+        if (skipped > 0) cout << "Warning: " << skipped << " records with duplicate IDs skipped.\n";
+        logger.Log("LOADED SNAPSHOT from " + filename);
+        cout << "Snapshot loaded: " << pipeManager.GetAll().size() << " pipes, "
+             << compressManager.GetAll().size() << " stations.\n";
+        return "";
     }
 
-private:
-    void SavePipes(ofstream& file, const vector<Pipe>& pipes) {
+    void SavePipes(ofstream& file, ItemRange<Pipe> pipes) {
         file << "===== PIPES DATA =====\n";
         for (const auto& pipe : pipes) {
             file << "ID: " << pipe.id << "\n";
@@ -147,7 +408,7 @@ private:
         }
     }
 
-    void SaveCompress(ofstream& file, const vector<Compress>& stations) {
+    void SaveCompress(ofstream& file, ItemRange<Compress> stations) {
         file << "\n===== COMPRESSOR STATIONS DATA =====\n";
         for (const auto& station : stations) {
             file << "ID: " << station.id << "\n";
@@ -159,25 +420,6 @@ private:
             file << "~~~\n";
         }
     }
-
-    void ParsePipeLine(const string& line, Pipe& pipe, bool& inPipe) {
-        if (line.find("ID: ") == 0) { pipe.id = stoi(line.substr(4)); inPipe = true; }
-        else if (line.find("KM Mark: ") == 0) pipe.km_mark = line.substr(9);
-        else if (line.find("Length (km): ") == 0) pipe.length = stod(line.substr(13));
-        else if (line.find("Diameter (mm): ") == 0) pipe.diametr = stoi(line.substr(15));
-        else if (line.find("On repair: ") == 0) pipe.repair = (line.substr(11) == "Yes");
-        else if (line.find("From CS: ") == 0) pipe.source_cs_id = stoi(line.substr(9));
-        else if (line.find("To CS: ") == 0) pipe.dest_cs_id = stoi(line.substr(7));
-    }
-
-    void ParseCompressLine(const string& line, Compress& station, bool& inStation) {
-        if (line.find("ID: ") == 0) { station.id = stoi(line.substr(4)); inStation = true; }
-        else if (line.find("Name: ") == 0) station.name = line.substr(6);
-        else if (line.find("Workshops: ") == 0) station.workshop_count = stoi(line.substr(11));
-        else if (line.find("Working: ") == 0) station.workshop_working = stoi(line.substr(9));
-        else if (line.find("Classification: ") == 0) station.classification = line.substr(16);
-        else if (line.find("Active: ") == 0) station.working = (line.substr(8) == "Yes");
-    }
 };
 
 #endif
\ No newline at end of file
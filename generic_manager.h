@@ -2,54 +2,336 @@
 #define GENERIC_MANAGER_H
 
 #include "logger.h"
+#include "scan_kernels.h"
 #include <vector>
+#include <unordered_map>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <algorithm>
 
 using namespace std;
 
+// Внешний наблюдатель за изменениями менеджера (журнал изменений и т.п.).
+// Вызывается после изменения, получает итоговое состояние элемента.
+template<typename T>
+class ManagerObserver {
+public:
+    virtual ~ManagerObserver() = default;
+    virtual void OnItemAdded(const T& item) = 0;
+    virtual void OnItemChanged(const T& item) = 0;
+    virtual void OnItemDeleted(int id) = 0;
+    virtual void OnItemsCleared() = 0;
+};
+
+// Хранилище блоками фиксированного размера: добавление не переносит уже лежащие
+// элементы, поэтому ссылки на них остаются действительными
+template<typename T>
+class ChunkedStore {
+private:
+    static constexpr size_t CHUNK_BITS = 10;
+    static constexpr size_t CHUNK = size_t(1) << CHUNK_BITS;
+
+    vector<unique_ptr<T[]>> chunks;
+    size_t count = 0;
+
+public:
+    size_t size() const { return count; }
+
+    T& operator[](size_t i) { return chunks[i >> CHUNK_BITS][i & (CHUNK - 1)]; }
+    const T& operator[](size_t i) const { return chunks[i >> CHUNK_BITS][i & (CHUNK - 1)]; }
+
+    T& push_back(T&& item) {
+        if ((count >> CHUNK_BITS) == chunks.size()) chunks.emplace_back(new T[CHUNK]);
+        T& slot = (*this)[count++];
+        slot = move(item);
+        return slot;
+    }
+
+    void reserve(size_t n) { chunks.reserve((n + CHUNK - 1) >> CHUNK_BITS); }
+
+    void clear() {
+        chunks.clear();
+        count = 0;
+    }
+
+    void swap(ChunkedStore& other) {
+        chunks.swap(other.chunks);
+        std::swap(count, other.count);
+    }
+};
+
+// Живые элементы менеджера в порядке добавления; удаленные слоты пропускаются.
+// Только чтение: изменения идут через Edit/Delete, чтобы хуки и индексы не расходились с данными.
+template<typename T>
+class ItemRange {
+public:
+    class Iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        Iterator(const ChunkedStore<T>* store, const SelectionBitmap* alive, size_t at)
+            : items(store), live(alive), slot(at) { SkipDead(); }
+
+        const T& operator*() const { return (*items)[slot]; }
+        const T* operator->() const { return &(*items)[slot]; }
+        Iterator& operator++() { slot++; SkipDead(); return *this; }
+        Iterator operator++(int) { Iterator before = *this; ++*this; return before; }
+        bool operator==(const Iterator& other) const { return slot == other.slot; }
+        bool operator!=(const Iterator& other) const { return slot != other.slot; }
+
+        size_t Slot() const { return slot; }
+
+    private:
+        const ChunkedStore<T>* items;
+        const SelectionBitmap* live;
+        size_t slot;
+
+        void SkipDead() {
+            while (slot < items->size() && !live->Test(slot)) slot++;
+        }
+    };
+
+    ItemRange(const ChunkedStore<T>& store, const SelectionBitmap& alive, size_t liveCount)
+        : items(&store), live(&alive), count(liveCount) {}
+
+    Iterator begin() const { return Iterator(items, live, 0); }
+    Iterator end() const { return Iterator(items, live, items->size()); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    const ChunkedStore<T>* items;
+    const SelectionBitmap* live;
+    size_t count;
+};
+
 template<typename T>
 class GenericManager {
 protected:
-    vector<T> items;
+    // Элементы в порядке добавления. Удаление оставляет на месте элемента пометку (слот
+    // выпадает из live), поэтому элементы не переезжают и порядок не меняется.
+    // Пустые слоты убирает Compact, который вызывается между командами.
+    ChunkedStore<T> items;
+    SelectionBitmap live;
+    size_t liveCount = 0;
+    // Индекс id -> слот в items, чтобы поиск и удаление работали за O(1)
+    unordered_map<int, size_t> slotById;
     int& nextId;
     Logger& logger;
+    vector<ManagerObserver<T>*> observers;
+
+    // Меньше этого числа пустых слотов не уплотняется
+    static constexpr size_t COMPACT_MIN_DEAD = 1024;
 
 public:
     GenericManager(int& id, Logger& log) : nextId(id), logger(log) {}
 
     virtual ~GenericManager() = default;
 
-    void Add(const T& item) {
-        T newItem = item;
-        newItem.id = nextId++;
-        items.push_back(newItem);
-        OnAdd(newItem);
+    void Add(const T& item) { Emplace(T(item)); }
+
+    // Добавление переносом, без копирования строк; ссылка действительна до удаления элемента
+    T& Emplace(T&& item) {
+        item.id = nextId++;
+        T& added = Insert(move(item));
+        OnAdd(added);
+        return added;
     }
 
-    T* FindById(int id) {
-        for (auto& item : items) {
-            if (item.id == id) return &item;
+    // Пакетное добавление: память резервируется один раз, элементы переносятся,
+    // получают непрерывный блок id [first, first + count). Вместо OnAdd на каждый элемент -
+    // одна сводная запись OnAddRange. onItem вызывается для каждого добавленного элемента.
+    // Возвращает первый id блока.
+    template<typename ItemHook>
+    int AddRange(vector<T> batch, ItemHook onItem) {
+        int first = nextId;
+        nextId += (int)batch.size();
+        size_t needed = items.size() + batch.size();
+        if (needed > live.words.capacity() * 64) Reserve(max(needed, items.size() * 2));
+        for (size_t i = 0; i < batch.size(); i++) {
+            batch[i].id = first + (int)i;
+            onItem(Insert(move(batch[i])));
         }
-        return nullptr;
+        if (!batch.empty()) OnAddRange(first, batch.size());
+        return first;
     }
 
-    bool Delete(int id) {
-        for (size_t i = 0; i < items.size(); i++) {
-            if (items[i].id == id) {
-                OnDelete(items[i]);
-                items.erase(items.begin() + i);
-                return true;
+    int AddRange(vector<T> batch) {
+        return AddRange(move(batch), [](const T&) {});
+    }
+
+    // Восстановление элемента с сохранением его id (загрузка из файла).
+    // В журнал не пишется; nextId продвигается за восстановленный id.
+    bool Restore(T item) {
+        if (slotById.count(item.id)) return false;
+        if (nextId <= item.id) nextId = item.id + 1;
+        Insert(move(item));
+        return true;
+    }
+
+    // Парная к Restore операция для воспроизведения журнала: удаление без записи
+    // в журнал операций (OnDelete не вызывается), остальные хуки работают как при Delete
+    bool Discard(int id) {
+        auto it = slotById.find(id);
+        if (it == slotById.end()) return false;
+        Erase(it->second);
+        return true;
+    }
+
+    // Массовое восстановление частей, собранных параллельно: память резервируется один раз,
+    // элементы переносятся без копирования. Возвращает число пропущенных дубликатов id.
+    size_t RestoreBulk(vector<vector<T>>& parts) {
+        size_t total = items.size();
+        for (const auto& part : parts) total += part.size();
+        Reserve(total);
+        size_t skipped = 0;
+        for (auto& part : parts) {
+            for (auto& item : part) {
+                if (!Restore(move(item))) skipped++;
             }
+            part.clear();
         }
-        return false;
+        return skipped;
+    }
+
+    void Reserve(size_t count) {
+        items.reserve(count);
+        live.words.reserve((count + 63) / 64);
+        slotById.reserve(count);
+        OnReserve(count);
+    }
+
+    // Указатель остается действительным, пока элемент не удален и не вызваны Clear/Compact:
+    // добавление и удаление других элементов его не затрагивают
+    T* FindById(int id) {
+        auto it = slotById.find(id);
+        return it == slotById.end() ? nullptr : &items[it->second];
+    }
+
+    const T* FindById(int id) const {
+        auto it = slotById.find(id);
+        return it == slotById.end() ? nullptr : &items[it->second];
+    }
+
+    // Удаление за O(1): слот помечается пустым, остальные элементы остаются на местах
+    bool Delete(int id) {
+        auto it = slotById.find(id);
+        if (it == slotById.end()) return false;
+
+        size_t slot = it->second;
+        OnDelete(items[slot]);
+        Erase(slot);
+        return true;
+    }
+
+    // Изменение элемента через функцию: наследники получают старое и новое состояние
+    template<typename Mutator>
+    bool Edit(int id, Mutator mutate) {
+        T* item = FindById(id);
+        if (!item) return false;
+        T before = *item;
+        mutate(*item);
+        item->id = before.id; // id элемента менять нельзя
+        OnEdit(before, *item);
+        for (auto* o : observers) o->OnItemChanged(*item);
+        return true;
     }
 
-    vector<T>& GetAll() { return items; }
-    const vector<T>& GetAll() const { return items; }
-    void Clear() { items.clear(); }
+    // Слот элемента или -1 (в хуках OnErase/OnEdit элемент еще на своем месте).
+    // Слоты нумеруют и удаленные элементы, поэтому маски по слотам имеют размер SlotCount()
+    long SlotOf(int id) const {
+        auto it = slotById.find(id);
+        return it == slotById.end() ? -1 : (long)it->second;
+    }
+
+    // Следующий выдаваемый id; AdvanceNextId только увеличивает счетчик (загрузка снимка)
+    int NextId() const { return nextId; }
+    void AdvanceNextId(int next) { if (nextId < next) nextId = next; }
+
+    size_t SlotCount() const { return items.size(); }
+    const T& AtSlot(size_t slot) const { return items[slot]; }
+    // Маска занятых слотов
+    const SelectionBitmap& LiveSlots() const { return live; }
+
+    ItemRange<T> GetAll() const { return ItemRange<T>(items, live, liveCount); }
+
+    void Clear() {
+        items.clear();
+        live.Reset(0);
+        liveCount = 0;
+        slotById.clear();
+        OnClear();
+        for (auto* o : observers) o->OnItemsCleared();
+    }
+
+    // Перенос живых элементов подряд с сохранением порядка. Слоты и указатели FindById
+    // после этого недействительны, поэтому вызывается только между командами.
+    void Compact() {
+        if (liveCount == items.size()) return;
+        ChunkedStore<T> packed;
+        packed.reserve(liveCount);
+        live.ForEach([&](size_t slot) {
+            slotById[items[slot].id] = packed.size();
+            packed.push_back(move(items[slot]));
+        });
+        items.swap(packed);
+        live.Reset(items.size(), true);
+        OnCompact();
+    }
+
+    // Уплотнение, если удаленных слотов накопилось не меньше, чем живых
+    bool CompactIfSparse() {
+        size_t dead = items.size() - liveCount;
+        if (dead < COMPACT_MIN_DEAD || dead < liveCount) return false;
+        Compact();
+        return true;
+    }
+
+    void AddObserver(ManagerObserver<T>* observer) { observers.push_back(observer); }
+
+    void RemoveObserver(ManagerObserver<T>* observer) {
+        observers.erase(remove(observers.begin(), observers.end(), observer), observers.end());
+    }
 
 protected:
+    // Вставка элемента с уже назначенным id и уведомление хуков обслуживания
+    T& Insert(T&& item) {
+        slotById[item.id] = items.size();
+        T& added = items.push_back(move(item));
+        live.PushBack(true);
+        liveCount++;
+        OnInsert(added);
+        for (auto* o : observers) o->OnItemAdded(added);
+        return added;
+    }
+
+    // Удаление без записи в журнал операций (OnDelete не вызывается)
+    void Erase(size_t slot) {
+        int id = items[slot].id;
+        OnErase(items[slot]);
+        slotById.erase(id);
+        live.Unset(slot);
+        liveCount--;
+        for (auto* o : observers) o->OnItemDeleted(id);
+    }
+
     virtual void OnAdd(const T& item) = 0;
+    virtual void OnAddRange(int firstId, size_t count) = 0;
     virtual void OnDelete(const T& item) = 0;
+
+    // Хуки для поддержки производных структур (индексов, пулов) в наследниках
+    virtual void OnInsert(const T&) {}
+    virtual void OnErase(const T&) {}
+    virtual void OnEdit(const T& /*before*/, const T& /*after*/) {}
+    virtual void OnClear() {}
+    virtual void OnReserve(size_t /*count*/) {}
+    // Слоты перенумерованы: производные структуры по слотам перестраиваются
+    virtual void OnCompact() {}
 };
 
 #endif
@@ -0,0 +1,334 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "structs.h"
+#include "generic_manager.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Журнал изменений (write-ahead) поверх полного сохранения.
+// Менеджеры сообщают об изменениях через ManagerObserver, записи копятся в памяти
+// и дописываются в конец файла при сохранении одним write + fdatasync.
+//
+// Запись: [uint32 размер данных][uint8 операция][данные][uint32 контрольная сумма].
+// Add/Edit хранят полное состояние элемента, поэтому повтор журнала поверх снимка,
+// который уже содержит эти изменения, дает тот же результат (важно при сбое во время сжатия).
+enum class JournalOp : uint8_t {
+    PipeAdd = 1, PipeEdit, PipeDelete, PipeClear,
+    StationAdd, StationEdit, StationDelete, StationClear
+};
+
+struct JournalReplayStats {
+    size_t records = 0;
+    size_t tornBytes = 0;   // отброшенный недописанный хвост
+    string error;
+};
+
+class Journal {
+private:
+    static constexpr char MAGIC[8] = {'G', 'A', 'S', 'J', 'R', 'N', 'L', '1'};
+
+    // Подписчики на каждый из менеджеров
+    template<typename T>
+    struct Tap : ManagerObserver<T> {
+        Journal* journal = nullptr;
+        GenericManager<T>* manager = nullptr;
+        JournalOp addOp, editOp, deleteOp, clearOp;
+
+        Tap(JournalOp a, JournalOp e, JournalOp d, JournalOp c) : addOp(a), editOp(e), deleteOp(d), clearOp(c) {}
+
+        void OnItemAdded(const T& item) override { journal->RecordItem(addOp, item); }
+        void OnItemChanged(const T& item) override { journal->RecordItem(editOp, item); }
+        void OnItemDeleted(int id) override { journal->RecordId(deleteOp, id); }
+        void OnItemsCleared() override { journal->RecordId(clearOp, 0); }
+    };
+
+    Tap<Pipe> pipeTap{JournalOp::PipeAdd, JournalOp::PipeEdit, JournalOp::PipeDelete, JournalOp::PipeClear};
+    Tap<Compress> stationTap{JournalOp::StationAdd, JournalOp::StationEdit, JournalOp::StationDelete, JournalOp::StationClear};
+
+    string pending;         // закодированные, еще не записанные изменения
+    size_t pendingRecords = 0;
+    bool paused = false;    // загрузка и повтор журнала не записываются
+
+public:
+    Journal() {
+        pipeTap.journal = this;
+        stationTap.journal = this;
+    }
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal() { Detach(); }
+
+    void Attach(GenericManager<Pipe>& pipes, GenericManager<Compress>& stations) {
+        Detach();
+        pipeTap.manager = &pipes;
+        stationTap.manager = &stations;
+        pipes.AddObserver(&pipeTap);
+        stations.AddObserver(&stationTap);
+    }
+
+    void Detach() {
+        if (pipeTap.manager) pipeTap.manager->RemoveObserver(&pipeTap);
+        if (stationTap.manager) stationTap.manager->RemoveObserver(&stationTap);
+        pipeTap.manager = nullptr;
+        stationTap.manager = nullptr;
+    }
+
+    void Pause(bool value) { paused = value; }
+
+    size_t PendingRecords() const { return pendingRecords; }
+    size_t PendingBytes() const { return pending.size(); }
+
+    void DiscardPending() {
+        pending.clear();
+        pendingRecords = 0;
+    }
+
+    static uint64_t FileBytes(const string& path) {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+    }
+
+    // Новый пустой журнал после полного сохранения (старые записи уже в снимке)
+    bool Reset(const string& path) {
+        DiscardPending();
+        string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1) return false;
+        bool ok = ::write(fd, MAGIC, sizeof(MAGIC)) == (ssize_t)sizeof(MAGIC) && fdatasync(fd) == 0;
+        ::close(fd);
+        return ok && rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // Дописать накопленные изменения одной группой и сбросить их на диск
+    bool Commit(const string& path) {
+        if (pending.empty()) return true;
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd == -1) return false;
+        bool ok = true;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size == 0) ok = WriteAll(fd, MAGIC, sizeof(MAGIC));
+        ok = ok && WriteAll(fd, pending.data(), pending.size()) && fdatasync(fd) == 0;
+        ::close(fd);
+        if (ok) DiscardPending();
+        return ok;
+    }
+
+    // Применение журнала к загруженному снимку. Недописанный хвост (сбой во время записи)
+    // отбрасывается и обрезается в файле, чтобы следующие записи шли за последней целой.
+    JournalReplayStats Replay(const string& path, GenericManager<Pipe>& pipes, GenericManager<Compress>& stations) {
+        JournalReplayStats stats;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return stats; // журнала нет - нечего применять
+        string data(FileBytes(path), '\0');
+        size_t got = 0;
+        while (got < data.size()) {
+            ssize_t n = ::read(fd, &data[got], data.size() - got);
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        ::close(fd);
+        data.resize(got);
+
+        if (data.size() < sizeof(MAGIC) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            stats.error = "not a journal file";
+            return stats;
+        }
+
+        bool wasPaused = paused;
+        paused = true;
+        size_t pos = sizeof(MAGIC);
+        while (pos < data.size()) {
+            size_t next = ApplyRecord(data, pos, pipes, stations);
+            if (next == 0) break;
+            pos = next;
+            stats.records++;
+        }
+        paused = wasPaused;
+
+        if (pos < data.size()) {
+            stats.tornBytes = data.size() - pos;
+            if (truncate(path.c_str(), (off_t)pos) != 0) stats.error = "could not truncate damaged journal tail";
+        }
+        return stats;
+    }
+
+private:
+    static bool WriteAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n <= 0) return false;
+            data += n;
+            size -= (size_t)n;
+        }
+        return true;
+    }
+
+    static uint32_t Checksum(const char* data, size_t size) {
+        uint32_t h = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < size; i++) {
+            h ^= (uint8_t)data[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // --- КОДИРОВАНИЕ ---
+    template<typename V>
+    static void Put(string& out, V value) { out.append((const char*)&value, sizeof(value)); }
+
+    static void PutString(string& out, const string& value) {
+        Put<uint32_t>(out, (uint32_t)value.size());
+        out += value;
+    }
+
+    static void Encode(string& out, const Pipe& p) {
+        Put<int32_t>(out, p.id);
+        Put<int32_t>(out, p.diametr);
+        Put<double>(out, p.length);
+        Put<int32_t>(out, p.source_cs_id);
+        Put<int32_t>(out, p.dest_cs_id);
+        Put<uint8_t>(out, p.repair);
+        PutString(out, p.km_mark);
+    }
+
+    static void Encode(string& out, const Compress& c) {
+        Put<int32_t>(out, c.id);
+        Put<int32_t>(out, c.workshop_count);
+        Put<int32_t>(out, c.workshop_working);
+        Put<uint8_t>(out, c.working);
+        PutString(out, c.name);
+        PutString(out, c.classification);
+    }
+
+    void BeginRecord(JournalOp op, size_t& start) {
+        start = pending.size();
+        Put<uint32_t>(pending, 0);
+        Put<uint8_t>(pending, (uint8_t)op);
+    }
+
+    void EndRecord(size_t start) {
+        uint32_t payload = (uint32_t)(pending.size() - start - sizeof(uint32_t) - 1);
+        memcpy(&pending[start], &payload, sizeof(payload));
+        Put<uint32_t>(pending, Checksum(pending.data() + start + sizeof(uint32_t), payload + 1));
+        pendingRecords++;
+    }
+
+    template<typename T>
+    void RecordItem(JournalOp op, const T& item) {
+        if (paused) return;
+        size_t start;
+        BeginRecord(op, start);
+        Encode(pending, item);
+        EndRecord(start);
+    }
+
+    void RecordId(JournalOp op, int id) {
+        if (paused) return;
+        size_t start;
+        BeginRecord(op, start);
+        Put<int32_t>(pending, id);
+        EndRecord(start);
+    }
+
+    // --- ДЕКОДИРОВАНИЕ ---
+    struct Reader {
+        const char* p;
+        const char* end;
+        bool ok = true;
+
+        template<typename V>
+        V Get() {
+            V value{};
+            if (end - p < (ptrdiff_t)sizeof(V)) { ok = false; return value; }
+            memcpy(&value, p, sizeof(V));
+            p += sizeof(V);
+            return value;
+        }
+
+        string GetString() {
+            uint32_t size = Get<uint32_t>();
+            if (!ok || (size_t)(end - p) < size) { ok = false; return string(); }
+            string value(p, size);
+            p += size;
+            return value;
+        }
+    };
+
+    static bool Decode(Reader& r, Pipe& p) {
+        p.id = r.Get<int32_t>();
+        p.diametr = r.Get<int32_t>();
+        p.length = r.Get<double>();
+        p.source_cs_id = r.Get<int32_t>();
+        p.dest_cs_id = r.Get<int32_t>();
+        p.repair = r.Get<uint8_t>() != 0;
+        p.km_mark = r.GetString();
+        return r.ok && r.p == r.end;
+    }
+
+    static bool Decode(Reader& r, Compress& c) {
+        c.id = r.Get<int32_t>();
+        c.workshop_count = r.Get<int32_t>();
+        c.workshop_working = r.Get<int32_t>();
+        c.working = r.Get<uint8_t>() != 0;
+        c.name = r.GetString();
+        c.classification = r.GetString();
+        return r.ok && r.p == r.end;
+    }
+
+    template<typename T>
+    static void Upsert(GenericManager<T>& manager, const T& item) {
+        if (manager.FindById(item.id)) manager.Edit(item.id, [&item](T& target) { target = item; });
+        else manager.Restore(item);
+    }
+
+    // Возвращает позицию следующей записи или 0, если запись повреждена или недописана
+    static size_t ApplyRecord(const string& data, size_t pos, GenericManager<Pipe>& pipes, GenericManager<Compress>& stations) {
+        const size_t overhead = sizeof(uint32_t) + 1 + sizeof(uint32_t);
+        if (data.size() - pos < overhead) return 0;
+        uint32_t payload;
+        memcpy(&payload, data.data() + pos, sizeof(payload));
+        if (data.size() - pos - overhead < payload) return 0;
+
+        const char* body = data.data() + pos + sizeof(uint32_t);
+        uint32_t checksum;
+        memcpy(&checksum, body + 1 + payload, sizeof(checksum));
+        if (checksum != Checksum(body, payload + 1)) return 0;
+
+        Reader r{body + 1, body + 1 + payload};
+        JournalOp op = (JournalOp)(uint8_t)body[0];
+        switch (op) {
+        case JournalOp::PipeAdd:
+        case JournalOp::PipeEdit: {
+            Pipe p = {};
+            if (!Decode(r, p)) return 0;
+            Upsert(pipes, p);
+            break;
+        }
+        case JournalOp::StationAdd:
+        case JournalOp::StationEdit: {
+            Compress c = {};
+            if (!Decode(r, c)) return 0;
+            Upsert(stations, c);
+            break;
+        }
+        case JournalOp::PipeDelete: pipes.Discard(r.Get<int32_t>()); break;
+        case JournalOp::StationDelete: stations.Discard(r.Get<int32_t>()); break;
+        case JournalOp::PipeClear: pipes.Clear(); break;
+        case JournalOp::StationClear: stations.Clear(); break;
+        default: return 0;
+        }
+        return pos + overhead + payload;
+    }
+};
+
+#endif
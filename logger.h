@@ -5,33 +5,224 @@
 #include <fstream>
 #include <iostream>
 #include <ctime>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
+enum class LoggerMode {
+    Sync,   // запись в файл при каждом вызове Log
+    Async   // очередь + фоновый поток записи пачками
+};
+
 class Logger {
 private:
     string logFile;
+    LoggerMode mode;
 
-public:
-    Logger(const string& filename = "operations_log.txt") : logFile(filename) {}
+    // --- АСИНХРОННЫЙ РЕЖИМ ---
+    // Очередь Вьюкова (много производителей, один потребитель) без блокировок:
+    // Log добавляет узел одним atomic exchange, поток записи забирает узлы с хвоста.
+    struct Entry {
+        atomic<Entry*> next{nullptr};
+        time_t time = 0;
+        string text;
+    };
 
-    string GetCurrentDateTime() const {
-        time_t now = time(0);
-        struct tm* timeinfo = localtime(&now);
+    static constexpr size_t FLUSH_BYTES = 64 * 1024;                      // порог размера пачки
+    static constexpr chrono::milliseconds FLUSH_INTERVAL{50};             // порог времени
+
+    atomic<Entry*> head{nullptr};   // последний добавленный узел (пишут производители)
+    Entry* tail = nullptr;          // фиктивный узел перед первым непрочитанным (только поток записи)
+
+    atomic<size_t> enqueued{0};
+    atomic<size_t> written{0};
+    atomic<int> flushWaiters{0};
+    atomic<bool> stopping{false};
+    thread writer;
+    int fd = -1;
+
+    // Поток записи без работы спит на wake; производитель будит его, только если он спит
+    mutex wakeLock;
+    condition_variable wake;
+    condition_variable drained;     // для Flush: written выросло
+    atomic<bool> sleeping{false};
+
+    // Кэш строки времени для потока записи: пересчитывается не чаще раза в секунду
+    time_t cachedTime = -1;
+    string cachedStamp;
+
+    const string& Stamp(time_t t) {
+        if (t != cachedTime) {
+            cachedTime = t;
+            cachedStamp = FormatTime(t);
+        }
+        return cachedStamp;
+    }
+
+    static string FormatTime(time_t t) {
+        struct tm timeinfo;
+        localtime_r(&t, &timeinfo);
         char buffer[80];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
         return string(buffer);
     }
 
+    void Push(Entry* entry) {
+        Entry* prev = head.exchange(entry, memory_order_acq_rel);
+        prev->next.store(entry, memory_order_release);
+        // seq_cst в паре с потоком записи: либо он увидит новый enqueued, либо мы увидим sleeping
+        enqueued.fetch_add(1);
+        if (sleeping.load()) {
+            lock_guard<mutex> guard(wakeLock);
+            wake.notify_one();
+        }
+    }
+
+    // Возвращает следующий готовый узел или nullptr; прочитанный фиктивный узел освобождается
+    Entry* Pop() {
+        Entry* next = tail->next.load(memory_order_acquire);
+        if (!next) return nullptr;
+        delete tail;
+        tail = next;
+        return next;
+    }
+
+    void WriteBatch(string& batch, size_t& batchCount) {
+        size_t offset = 0;
+        while (fd != -1 && offset < batch.size()) {
+            ssize_t n = ::write(fd, batch.data() + offset, batch.size() - offset);
+            if (n <= 0) break;
+            offset += (size_t)n;
+        }
+        batch.clear();
+        written.fetch_add(batchCount, memory_order_release);
+        batchCount = 0;
+        if (flushWaiters.load() > 0) {
+            lock_guard<mutex> guard(wakeLock);
+            drained.notify_all();
+        }
+    }
+
+    void WriterLoop() {
+        string batch;
+        batch.reserve(FLUSH_BYTES * 2);
+        size_t batchCount = 0;
+        size_t consumed = 0;
+        auto lastFlush = chrono::steady_clock::now();
+
+        while (true) {
+            bool stop = stopping.load(memory_order_acquire);
+            while (Entry* e = Pop()) {
+                batch += '[';
+                batch += Stamp(e->time);
+                batch += "] ";
+                batch += e->text;
+                batch += '\n';
+                e->text = string(); // память строки больше не нужна, узел станет фиктивным
+                batchCount++;
+                consumed++;
+                if (batch.size() >= FLUSH_BYTES) {
+                    WriteBatch(batch, batchCount);
+                    lastFlush = chrono::steady_clock::now();
+                }
+            }
+
+            auto now = chrono::steady_clock::now();
+            if (batchCount > 0 && (stop || flushWaiters.load() > 0 || now - lastFlush >= FLUSH_INTERVAL)) {
+                WriteBatch(batch, batchCount);
+                lastFlush = now;
+            } else if (batchCount == 0) {
+                lastFlush = now;
+            }
+
+            // Завершаемся, только когда все добавленные до остановки записи сохранены
+            if (stop && consumed == enqueued.load()) break;
+
+            // Очередь пуста: сон до новой записи, а с неполной пачкой - до срока ее записи
+            unique_lock<mutex> guard(wakeLock);
+            sleeping.store(true);
+            bool idle = consumed == enqueued.load() && !stopping.load() && !(batchCount > 0 && flushWaiters.load() > 0);
+            if (idle && batchCount > 0) wake.wait_until(guard, lastFlush + FLUSH_INTERVAL);
+            else if (idle) wake.wait(guard);
+            sleeping.store(false);
+        }
+    }
+
+    void StartWriter() {
+        fd = ::open(logFile.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        tail = new Entry();
+        head.store(tail, memory_order_relaxed);
+        writer = thread(&Logger::WriterLoop, this);
+    }
+
+    void StopWriter() {
+        {
+            lock_guard<mutex> guard(wakeLock);
+            stopping.store(true, memory_order_release);
+        }
+        wake.notify_one();
+        writer.join();
+        while (Pop()) {}
+        delete tail;
+        tail = nullptr;
+        if (fd != -1) ::close(fd);
+        fd = -1;
+    }
+
+public:
+    Logger(const string& filename = "operations_log.txt", LoggerMode logMode = LoggerMode::Sync)
+        : logFile(filename), mode(logMode) {
+        if (mode == LoggerMode::Async) StartWriter();
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger() {
+        if (mode == LoggerMode::Async) StopWriter();
+    }
+
+    string GetCurrentDateTime() const {
+        return FormatTime(time(0));
+    }
+
     void Log(const string& action) {
+        if (mode == LoggerMode::Async) {
+            Entry* entry = new Entry();
+            entry->time = time(0);
+            entry->text = action;
+            Push(entry);
+            return;
+        }
+
         ofstream file(logFile, ios::app);
         if (file.is_open()) {
-            file << "[" << GetCurrentDateTime() << "] " << action << "\n";
+            file << "[" << FormatTime(time(0)) << "] " << action << "\n";
             file.close();
         }
     }
 
-    void ViewLogs() const {
+    // Дождаться записи в файл всего, что было передано в Log до вызова
+    void Flush() {
+        if (mode != LoggerMode::Async) return;
+        size_t target = enqueued.load(memory_order_acquire);
+        flushWaiters.fetch_add(1);
+        {
+            unique_lock<mutex> guard(wakeLock);
+            wake.notify_one();
+            drained.wait(guard, [&]() { return written.load(memory_order_acquire) >= target; });
+        }
+        flushWaiters.fetch_sub(1);
+    }
+
+    void ViewLogs() {
+        Flush();
         ifstream file(logFile);
         if (!file.is_open()) {
             cout << "\nNo log file found yet.\n";
@@ -46,7 +237,7 @@ public:
             lineCount++;
         }
         file.close();
-        
+
         if (lineCount == 0) {
             cout << "No operations logged yet.\n";
         }
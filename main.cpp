@@ -4,12 +4,22 @@
 #include "compress_manager.h"
 #include "file_manager.h"
 #include "ui_controller.h"
+#include "batch_runner.h"
+#include "rpc_server.h"
+#include <csignal>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
 
 using namespace std;
 
 class Application {
 private:
-    Logger logger;
+    static inline RpcServer* activeServer = nullptr;
+    static void StopServer(int) { if (activeServer) activeServer->Stop(); }
+
+    Logger logger{"operations_log.txt", LoggerMode::Async};
     int nextPipeId = 1;
     int nextCompressId = 1;
     PipeManager pipeManager;
@@ -23,9 +33,40 @@ public:
           compressManager(nextCompressId, logger),
           fileManager(logger),
           ui(pipeManager, compressManager, logger, fileManager) {
+        pipeManager.EnableColumns();
+        compressManager.EnableColumns();
+        pipeManager.EnableIndexes();
+        compressManager.EnableIndexes();
+        fileManager.AttachJournal(pipeManager, compressManager);
         logger.Log("APPLICATION STARTED");
     }
 
+    // Пакетный режим: команды из потока, без меню и подсказок. Код возврата 1, если были ошибки.
+    int RunBatch(istream& in, bool json) {
+        BatchRunner runner(pipeManager, compressManager, fileManager, logger, nextPipeId, nextCompressId, json);
+        BatchRunner::Summary summary = runner.Run(in, cout);
+        return summary.failed ? 1 : 0;
+    }
+
+    // Режим сервера: запросы по сокету до SIGINT/SIGTERM
+    int Serve(const RpcServer::Options& options) {
+        BatchRunner runner(pipeManager, compressManager, fileManager, logger, nextPipeId, nextCompressId, true);
+        VersionedNetwork versions(pipeManager, compressManager);
+        RpcServer server(options, logger, runner, versions);
+        if (!server.Start()) {
+            cerr << "Error: " << server.Error() << "\n";
+            return 2;
+        }
+        activeServer = &server;
+        signal(SIGINT, StopServer);
+        signal(SIGTERM, StopServer);
+        cerr << "Listening on " << server.Endpoint() << "\n";
+        server.Serve();
+        activeServer = nullptr;
+        cerr << "Served " << server.Served() << " requests\n";
+        return 0;
+    }
+
     void Run() {
         int choice;
         while (true) {
@@ -48,6 +89,10 @@ public:
             cout << "14. Calculate Shortest Path (Dijkstra)\n";
             cout << "15. Calculate Max Flow\n";
             cout << "16. Disconnect Pipe\n";
+            cout << "20. Distance Matrix (all CS)\n";
+            cout << "21. Benchmark Distance Matrix Scaling\n";
+            cout << "22. Preprocess Routes (Contraction Hierarchy)\n";
+            cout << "23. Analyze Snapshot (memory-mapped, read-only)\n";
             cout << "---------------------\n";
             cout << "17. Save all data\n";
             cout << "18. Load all data\n";
@@ -78,6 +123,10 @@ public:
             case 14: ui.CalculatePath(); break;
             case 15: ui.CalculateFlow(); break;
             case 16: ui.DisconnectNetwork(); break;
+            case 20: ui.CalculateDistanceMatrix(); break;
+            case 21: ui.BenchmarkDistanceMatrix(); break;
+            case 22: ui.PrepareRoutes(); break;
+            case 23: ui.AnalyzeSnapshot(); break;
             
             case 17: ui.SaveData(); break;
             case 18: ui.LoadData(nextPipeId, nextCompressId); break;
@@ -85,12 +134,66 @@ public:
             case 0: return;
             default: cout << "Invalid option.\n";
             }
+            // Между командами указатели на записи никто не держит: можно убрать пустые слоты
+            pipeManager.CompactIfSparse();
+            compressManager.CompactIfSparse();
         }
     }
 };
 
-int main() {
+// Целое число в [lo, hi] целиком, без хвоста; false для "abc", "80x", пустой строки и выхода за пределы
+static bool ParseIntArg(const char* text, long lo, long hi, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (errno || end == text || *end || parsed < lo || parsed > hi) return false;
+    value = (int)parsed;
+    return true;
+}
+
+// Запуск: без аргументов - меню; --batch [file] - команды из файла (или stdin), --json - ответы JSON-строками;
+// --serve unix:PATH|tcp:PORT [--workers N] - сервер запросов
+int main(int argc, char* argv[]) {
+    bool batch = false, json = false, serve = false, valid = true;
+    string script;
+    RpcServer::Options server;
+    for (int i = 1; i < argc && valid; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') script = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve = true;
+            string endpoint = argv[++i];
+            if (endpoint.rfind("unix:", 0) == 0) server.unixPath = endpoint.substr(5);
+            else if (endpoint.rfind("tcp:", 0) == 0) valid = ParseIntArg(endpoint.c_str() + 4, 1, 65535, server.tcpPort);
+            else valid = false;
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            valid = ParseIntArg(argv[++i], 1, 1024, server.workers);
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || (serve && batch)) {
+        cerr << "Usage: " << argv[0] << " [--batch [file]] [--json] | --serve unix:PATH|tcp:PORT [--workers N]\n";
+        return 2;
+    }
+
     Application app;
-    app.Run();
-    return 0;
+    if (serve) return app.Serve(server);
+    if (!batch) {
+        app.Run();
+        return 0;
+    }
+
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    if (script.empty() || script == "-") return app.RunBatch(cin, json);
+    ifstream file(script);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open " << script << "\n";
+        return 2;
+    }
+    return app.RunBatch(file, json);
 }
\ No newline at end of file
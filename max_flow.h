@@ -0,0 +1,362 @@
+#ifndef MAX_FLOW_H
+#define MAX_FLOW_H
+
+#include "network_graph.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+enum class MaxFlowAlgorithm {
+    Dinic,          // уровневый граф + блокирующий поток
+    PushRelabel     // проталкивание предпотока, выбор вершины с наибольшей высотой
+};
+
+struct MaxFlowResult {
+    string error;                        // пусто, если расчет выполнен
+    double totalFlow = 0;
+    vector<pair<int, double>> pipeFlows; // (ID трубы, поток) для труб с ненулевым потоком
+    vector<int> minCutPipes;             // трубы минимального разреза
+
+    bool Ok() const { return error.empty(); }
+};
+
+// Решатель задачи о максимальном потоке на плоских массивах.
+// Остаточная сеть: для каждого ребра графа прямая дуга (остаток cap - flow)
+// и обратная дуга (остаток flow), дуги вершины лежат подряд.
+// Решатель хранит собственную копию графа, поэтому найденный поток можно
+// донастраивать при изменении пропускной способности отдельных труб.
+class MaxFlowSolver {
+private:
+    static constexpr double EPS = 1e-9;
+
+    NetworkGraph g;
+    int n;
+
+    vector<int> arcStart;
+    vector<int> arcTo;
+    vector<int> arcRev;      // парная дуга
+    vector<int> arcEdge;     // ребро графа для прямой дуги, -1 для обратной
+    vector<double> arcCap;   // остаточная пропускная способность
+    vector<int> edgeArc;     // ребро графа -> прямая дуга
+
+    // Рабочие буферы, переиспользуются между вызовами
+    vector<int> level;
+    vector<int> current;
+    vector<int> queueBuf;
+    vector<int> pathArcs;
+
+    int source = -1;
+    int sink = -1;
+    double flowValue = 0;
+
+public:
+    explicit MaxFlowSolver(const NetworkGraph& graph) : g(graph), n(graph.VertexCount()) {
+        int m = g.EdgeCount();
+        arcStart.assign(n + 1, 0);
+        for (int e = 0; e < m; e++) {
+            arcStart[g.edgeFrom[e] + 1]++;
+            arcStart[g.edgeTo[e] + 1]++;
+        }
+        for (int v = 0; v < n; v++) arcStart[v + 1] += arcStart[v];
+
+        arcTo.assign(2 * m, 0);
+        arcRev.assign(2 * m, 0);
+        arcEdge.assign(2 * m, -1);
+        arcCap.assign(2 * m, 0);
+        edgeArc.assign(m, 0);
+
+        vector<int> pos(arcStart.begin(), arcStart.end() - 1);
+        for (int e = 0; e < m; e++) {
+            int u = g.edgeFrom[e];
+            int v = g.edgeTo[e];
+            int a = pos[u]++;
+            int b = pos[v]++;
+            arcTo[a] = v; arcRev[a] = b; arcEdge[a] = e; arcCap[a] = g.edgeCapacity[e];
+            arcTo[b] = u; arcRev[b] = a;
+            edgeArc[e] = a;
+        }
+
+        level.assign(n, 0);
+        current.assign(n, 0);
+        queueBuf.assign(n, 0);
+    }
+
+    double Solve(int s, int t, MaxFlowAlgorithm algorithm) {
+        source = s;
+        sink = t;
+        flowValue = 0;
+        if (algorithm == MaxFlowAlgorithm::PushRelabel) RunPushRelabel();
+        else flowValue = Augment(source, sink, numeric_limits<double>::infinity(), -1);
+        return flowValue;
+    }
+
+    double FlowValue() const { return flowValue; }
+
+    double EdgeFlow(int e) const { return g.edgeCapacity[e] - arcCap[edgeArc[e]]; }
+
+    const NetworkGraph& Graph() const { return g; }
+
+    // Изменение пропускной способности трубы с восстановлением максимального потока
+    // из текущего решения: при уменьшении отменяется только поток, не помещающийся в трубу,
+    // при увеличении поток дополняется по остаточной сети.
+    // Возвращает false, если решение нельзя починить локально (нужен новый Solve).
+    bool UpdatePipeCapacity(int pipeId, double capacity) {
+        int e = g.EdgeOfPipe(pipeId);
+        return e == -1 || UpdateCapacity(e, capacity);
+    }
+
+    bool UpdateCapacity(int e, double capacity) {
+        int a = edgeArc[e];
+        int b = arcRev[a];
+        double flow = arcCap[b];
+        g.edgeCapacity.Set(e, capacity);
+
+        if (flow > capacity + EPS) {
+            // Поток по ребру u -> v превышает новую пропускную способность на excess:
+            // у u образуется избыток, у v - недостаток
+            int u = g.edgeFrom[e], v = g.edgeTo[e];
+            double excess = flow - capacity;
+            arcCap[b] = capacity;
+            arcCap[a] = 0;
+
+            // 1. Пускаем избыток в обход ребра от u к v
+            excess -= Augment(u, v, excess, -1);
+            if (excess > EPS) {
+                // 2. Отменяем остаток: возвращаем его от u к истоку и забираем от стока к v,
+                //    не проходя через второй полюс
+                if (u != source && Augment(u, source, excess, sink) < excess - EPS) return false;
+                if (v != sink && Augment(sink, v, excess, source) < excess - EPS) return false;
+                flowValue -= excess;
+            }
+        } else {
+            arcCap[a] = capacity - flow;
+        }
+
+        // 3. Дополняем поток по остаточной сети (новые пути после увеличения или обхода)
+        flowValue += Augment(source, sink, numeric_limits<double>::infinity(), -1);
+        return true;
+    }
+
+    // Поток по трубам и минимальный разрез (вершины, достижимые из истока в остаточной сети)
+    void FillResult(MaxFlowResult& result) {
+        result.totalFlow = flowValue;
+        result.pipeFlows.clear();
+        result.minCutPipes.clear();
+
+        for (int e = 0; e < g.EdgeCount(); e++) {
+            double f = EdgeFlow(e);
+            if (f > EPS) result.pipeFlows.push_back({g.edgePipe[e], f});
+        }
+
+        BuildLevels(source, -1, -1);
+        for (int e = 0; e < g.EdgeCount(); e++) {
+            if (g.edgeCapacity[e] > 0 && level[g.edgeFrom[e]] >= 0 && level[g.edgeTo[e]] < 0) {
+                result.minCutPipes.push_back(g.edgePipe[e]);
+            }
+        }
+        sort(result.minCutPipes.begin(), result.minCutPipes.end());
+    }
+
+private:
+    // BFS по дугам с положительным остатком; level[v] = -1 для недостижимых.
+    // Вершина blocked не посещается. Возвращает true, если достигнута вершина target.
+    bool BuildLevels(int from, int target, int blocked) {
+        fill(level.begin(), level.end(), -1);
+        size_t head = 0, tail = 0;
+        queueBuf[tail++] = from;
+        level[from] = 0;
+        while (head < tail) {
+            int u = queueBuf[head++];
+            for (int a = arcStart[u]; a < arcStart[u + 1]; a++) {
+                int v = arcTo[a];
+                if (level[v] < 0 && v != blocked && arcCap[a] > EPS) {
+                    level[v] = level[u] + 1;
+                    queueBuf[tail++] = v;
+                }
+            }
+        }
+        return target >= 0 && level[target] >= 0;
+    }
+
+    // --- Диниц ---
+    // Пропускает из from в to не более limit единиц по остаточной сети
+    double Augment(int from, int to, double limit, int blocked) {
+        double total = 0;
+        while (total < limit - EPS && BuildLevels(from, to, blocked)) {
+            for (int v = 0; v < n; v++) current[v] = arcStart[v];
+            total += BlockingFlow(from, to, limit - total);
+        }
+        return total;
+    }
+
+    // Блокирующий поток итеративным DFS (без рекурсии, чтобы не упираться в стек на длинных магистралях)
+    double BlockingFlow(int from, int to, double limit) {
+        double total = 0;
+        pathArcs.clear();
+        int u = from;
+        while (total < limit - EPS) {
+            if (u == to) {
+                double pushed = limit - total;
+                for (int a : pathArcs) pushed = min(pushed, arcCap[a]);
+                size_t cut = pathArcs.size();
+                for (size_t i = 0; i < pathArcs.size(); i++) {
+                    int a = pathArcs[i];
+                    arcCap[a] -= pushed;
+                    arcCap[arcRev[a]] += pushed;
+                    if (cut == pathArcs.size() && arcCap[a] <= EPS) cut = i;
+                }
+                total += pushed;
+                // Возвращаемся к началу первой насыщенной дуги
+                pathArcs.resize(cut);
+                u = pathArcs.empty() ? from : arcTo[pathArcs.back()];
+                continue;
+            }
+
+            int& a = current[u];
+            while (a < arcStart[u + 1] && !(arcCap[a] > EPS && level[arcTo[a]] == level[u] + 1)) a++;
+
+            if (a < arcStart[u + 1]) {
+                pathArcs.push_back(a);
+                u = arcTo[a];
+            } else {
+                // Тупик: вершина больше не участвует в этой фазе
+                level[u] = -1;
+                if (pathArcs.empty()) break;
+                pathArcs.pop_back();
+                u = pathArcs.empty() ? from : arcTo[pathArcs.back()];
+                current[u]++;
+            }
+        }
+        return total;
+    }
+
+    // --- Push-relabel (highest label) ---
+    void RunPushRelabel() {
+        vector<double> excess(n, 0);
+        vector<int>& height = level;
+        vector<vector<int>> buckets(2 * n + 1);
+        vector<int> heightCount(2 * n + 1, 0);
+        int highest = 0;
+        int relabelsSinceGlobal = 0;
+
+        auto activate = [&](int v) {
+            if (v != source && v != sink && excess[v] > EPS) {
+                buckets[height[v]].push_back(v);
+                highest = max(highest, height[v]);
+            }
+        };
+
+        // Точная разметка высот: расстояние до стока, для остальных - n + расстояние до истока
+        auto globalRelabel = [&]() {
+            fill(height.begin(), height.end(), 2 * n);
+            ReverseBfs(sink, 0, height);
+            height[source] = n;
+            ReverseBfs(source, n, height);
+            fill(heightCount.begin(), heightCount.end(), 0);
+            for (auto& b : buckets) b.clear();
+            highest = 0;
+            for (int v = 0; v < n; v++) {
+                heightCount[height[v]]++;
+                activate(v);
+            }
+            relabelsSinceGlobal = 0;
+        };
+
+        // Насыщаем все дуги из истока
+        for (int a = arcStart[source]; a < arcStart[source + 1]; a++) {
+            double c = arcCap[a];
+            if (c > EPS) {
+                arcCap[a] = 0;
+                arcCap[arcRev[a]] += c;
+                excess[arcTo[a]] += c;
+                excess[source] -= c;
+            }
+        }
+        globalRelabel();
+        for (int v = 0; v < n; v++) current[v] = arcStart[v];
+
+        while (highest >= 0) {
+            if (buckets[highest].empty()) { highest--; continue; }
+            int u = buckets[highest].back();
+            buckets[highest].pop_back();
+            if (height[u] != highest || excess[u] <= EPS) continue;
+
+            // Разгрузка вершины u
+            while (excess[u] > EPS) {
+                int& a = current[u];
+                if (a == arcStart[u + 1]) {
+                    // Подъем
+                    int oldHeight = height[u];
+                    int newHeight = 2 * n;
+                    for (int b = arcStart[u]; b < arcStart[u + 1]; b++) {
+                        if (arcCap[b] > EPS) newHeight = min(newHeight, height[arcTo[b]] + 1);
+                    }
+                    heightCount[oldHeight]--;
+                    height[u] = newHeight;
+                    heightCount[newHeight]++;
+                    a = arcStart[u];
+
+                    // Разрыв: вершины выше пустого уровня (ниже n) не могут достичь стока
+                    if (heightCount[oldHeight] == 0 && oldHeight < n) {
+                        for (int v = 0; v < n; v++) {
+                            if (height[v] > oldHeight && height[v] < n && v != source) {
+                                heightCount[height[v]]--;
+                                height[v] = n + 1;
+                                heightCount[n + 1]++;
+                                current[v] = arcStart[v];
+                                activate(v);
+                            }
+                        }
+                    }
+                    if (++relabelsSinceGlobal > n) {
+                        globalRelabel();
+                        for (int v = 0; v < n; v++) current[v] = arcStart[v];
+                        activate(u);
+                        break;
+                    }
+                    if (height[u] >= 2 * n) break;
+                    continue;
+                }
+
+                int v = arcTo[a];
+                if (arcCap[a] > EPS && height[u] == height[v] + 1) {
+                    double d = min(excess[u], arcCap[a]);
+                    arcCap[a] -= d;
+                    arcCap[arcRev[a]] += d;
+                    excess[u] -= d;
+                    bool wasActive = excess[v] > EPS;
+                    excess[v] += d;
+                    if (!wasActive) activate(v);
+                } else {
+                    a++;
+                }
+            }
+            if (excess[u] > EPS && height[u] < 2 * n) activate(u);
+        }
+
+        flowValue = excess[sink];
+    }
+
+    // BFS от root по обратным остаточным дугам: height[u] = base + расстояние от u до root
+    void ReverseBfs(int root, int base, vector<int>& height) {
+        size_t head = 0, tail = 0;
+        if (height[root] > base) height[root] = base;
+        queueBuf[tail++] = root;
+        while (head < tail) {
+            int v = queueBuf[head++];
+            for (int a = arcStart[v]; a < arcStart[v + 1]; a++) {
+                int u = arcTo[a];
+                // Остаток дуги u -> v хранится в парной дуге
+                if (height[u] == 2 * n && u != source && arcCap[arcRev[a]] > EPS) {
+                    height[u] = height[v] + 1;
+                    queueBuf[tail++] = u;
+                }
+            }
+        }
+    }
+};
+
+#endif
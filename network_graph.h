@@ -0,0 +1,224 @@
+#ifndef NETWORK_GRAPH_H
+#define NETWORK_GRAPH_H
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+// Неизменяемый массив, общий для копий графа: копирование графа копирует указатели,
+// а не данные. Чтение по индексу - как из vector.
+template<typename T>
+class SharedArray {
+private:
+    shared_ptr<const vector<T>> owner;
+    const T* items = nullptr;
+    size_t count = 0;
+
+public:
+    void assign(vector<T> values) {
+        auto data = make_shared<const vector<T>>(move(values));
+        items = data->data();
+        count = data->size();
+        owner = move(data);
+    }
+
+    const T& operator[](size_t i) const { return items[i]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+};
+
+// Массив блоками с копированием при записи: копии графа разделяют блоки,
+// Set копирует только изменяемый блок, если он еще общий с другой копией
+template<typename T>
+class CowArray {
+private:
+    static constexpr size_t BLOCK_BITS = 12;
+    static constexpr size_t BLOCK = size_t(1) << BLOCK_BITS;
+
+    vector<shared_ptr<T[]>> blocks;
+    size_t count = 0;
+
+public:
+    void assign(const vector<T>& values) {
+        count = values.size();
+        blocks.assign((count + BLOCK - 1) >> BLOCK_BITS, nullptr);
+        for (size_t b = 0; b < blocks.size(); b++) {
+            blocks[b].reset(new T[BLOCK]());
+            copy(values.begin() + b * BLOCK, values.begin() + min(count, (b + 1) * BLOCK), blocks[b].get());
+        }
+    }
+
+    const T& operator[](size_t i) const { return blocks[i >> BLOCK_BITS][i & (BLOCK - 1)]; }
+    size_t size() const { return count; }
+
+    void Set(size_t i, const T& value) {
+        shared_ptr<T[]>& block = blocks[i >> BLOCK_BITS];
+        // Счетчик ссылок может только уменьшиться другими потоками: в худшем случае лишняя копия
+        if (block.use_count() > 1) {
+            shared_ptr<T[]> own(new T[BLOCK]);
+            copy(block.get(), block.get() + BLOCK, own.get());
+            block = move(own);
+        }
+        block[i & (BLOCK - 1)] = value;
+    }
+
+    // Индексы, где значение отличается от other того же размера; общие блоки не сравниваются
+    template<typename Visitor>
+    void ForEachDifference(const CowArray& other, Visitor visit) const {
+        for (size_t b = 0; b < blocks.size(); b++) {
+            if (blocks[b] == other.blocks[b]) continue;
+            for (size_t i = b << BLOCK_BITS; i < min(count, (b + 1) << BLOCK_BITS); i++) {
+                if ((*this)[i] != other[i]) visit(i);
+            }
+        }
+    }
+};
+
+// Компактное представление сети в формате CSR (compressed sparse row).
+// Вершины - КС, перенумерованные плотно (0..n-1), ребра - подключенные трубы.
+// Исходящие ребра вершины u лежат подряд в [outStart[u], outStart[u+1]).
+// Структура неизменяема и разделяется копиями графа; ремонт и пропускная способность
+// хранятся блоками с копированием при записи, поэтому копия графа с другим ремонтом
+// стоит O(число блоков), а не O(ребра).
+struct NetworkGraph {
+    SharedArray<int> stationIds;         // плотный индекс -> ID КС
+    shared_ptr<const unordered_map<int, int>> indexOf;     // ID КС -> плотный индекс
+
+    SharedArray<int> outStart;
+    SharedArray<int> edgeFrom;
+    SharedArray<int> edgeTo;
+    SharedArray<double> edgeLength;
+    CowArray<double> edgeCapacity;       // 0 для труб в ремонте
+    SharedArray<int> edgePipe;           // ID трубы
+    CowArray<char> edgeRepair;
+    shared_ptr<const unordered_map<int, int>> edgeByPipe;  // ID трубы -> ребро
+
+    // Обратный индекс: входящие ребра вершины v - inEdge[inStart[v] .. inStart[v+1])
+    SharedArray<int> inStart;
+    SharedArray<int> inEdge;
+
+    int VertexCount() const { return (int)stationIds.size(); }
+    int EdgeCount() const { return (int)edgeTo.size(); }
+
+    int IndexOf(int stationId) const {
+        if (!indexOf) return -1;
+        auto it = indexOf->find(stationId);
+        return it == indexOf->end() ? -1 : it->second;
+    }
+
+    int EdgeOfPipe(int pipeId) const {
+        if (!edgeByPipe) return -1;
+        auto it = edgeByPipe->find(pipeId);
+        return it == edgeByPipe->end() ? -1 : it->second;
+    }
+
+    // Обновление признака ремонта без перестройки структуры
+    template<typename PipeT, typename CapacityFn>
+    int UpdateRepair(const PipeT& pipe, CapacityFn capacity) {
+        int e = EdgeOfPipe(pipe.id);
+        if (e != -1) {
+            edgeRepair.Set(e, pipe.repair);
+            edgeCapacity.Set(e, capacity(pipe));
+        }
+        return e;
+    }
+
+    // Копии одного графа (разделяют структуру и отличаются только ремонтом)
+    bool SameStructure(const NetworkGraph& other) const {
+        return outStart.begin() == other.outStart.begin() && edgeTo.begin() == other.edgeTo.begin() &&
+               edgeLength.begin() == other.edgeLength.begin();
+    }
+
+    // Ребра, у которых ремонт отличается от other; только для графов с общей структурой
+    template<typename Visitor>
+    void ForEachRepairChange(const NetworkGraph& other, Visitor visit) const {
+        edgeRepair.ForEachDifference(other.edgeRepair, [&](size_t e) { visit((int)e); });
+    }
+
+    // Есть ли у вершины хотя бы одно ребро с ненулевой пропускной способностью
+    bool HasFlowEdges(int v) const {
+        for (int e = outStart[v]; e < outStart[v + 1]; e++) {
+            if (edgeCapacity[e] > 0) return true;
+        }
+        for (int i = inStart[v]; i < inStart[v + 1]; i++) {
+            if (edgeCapacity[inEdge[i]] > 0) return true;
+        }
+        return false;
+    }
+
+    // Построение по набору труб. В граф попадают только трубы, подключенные с обеих сторон.
+    template<typename PipeRange, typename CapacityFn>
+    void Build(const PipeRange& pipes, CapacityFn capacity) {
+        vector<int> ids;
+        for (const auto& pipe : pipes) {
+            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0) {
+                ids.push_back(pipe.source_cs_id);
+                ids.push_back(pipe.dest_cs_id);
+            }
+        }
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        auto index = make_shared<unordered_map<int, int>>();
+        index->reserve(ids.size());
+        for (int i = 0; i < (int)ids.size(); i++) (*index)[ids[i]] = i;
+
+        int n = (int)ids.size();
+        vector<int> out(n + 1, 0);
+        vector<int> in(n + 1, 0);
+        for (const auto& pipe : pipes) {
+            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0) {
+                out[(*index)[pipe.source_cs_id] + 1]++;
+                in[(*index)[pipe.dest_cs_id] + 1]++;
+            }
+        }
+        for (int v = 0; v < n; v++) {
+            out[v + 1] += out[v];
+            in[v + 1] += in[v];
+        }
+
+        int m = out[n];
+        vector<int> from(m, 0), to(m, 0), pipeIds(m, 0), inEdges(m, 0);
+        vector<double> lengths(m, 0), capacities(m, 0);
+        vector<char> repairs(m, 0);
+        auto byPipe = make_shared<unordered_map<int, int>>();
+        byPipe->reserve(m);
+
+        // Раскладываем ребра по вершинам, сохраняя исходный порядок труб
+        vector<int> outPos(out.begin(), out.end() - 1);
+        vector<int> inPos(in.begin(), in.end() - 1);
+        for (const auto& pipe : pipes) {
+            if (pipe.source_cs_id == 0 || pipe.dest_cs_id == 0) continue;
+            int u = (*index)[pipe.source_cs_id];
+            int v = (*index)[pipe.dest_cs_id];
+            int e = outPos[u]++;
+            from[e] = u;
+            to[e] = v;
+            lengths[e] = pipe.length;
+            capacities[e] = capacity(pipe);
+            pipeIds[e] = pipe.id;
+            repairs[e] = pipe.repair;
+            inEdges[inPos[v]++] = e;
+            (*byPipe)[pipe.id] = e;
+        }
+
+        stationIds.assign(move(ids));
+        indexOf = move(index);
+        outStart.assign(move(out));
+        inStart.assign(move(in));
+        edgeFrom.assign(move(from));
+        edgeTo.assign(move(to));
+        edgeLength.assign(move(lengths));
+        edgePipe.assign(move(pipeIds));
+        inEdge.assign(move(inEdges));
+        edgeCapacity.assign(capacities);
+        edgeRepair.assign(repairs);
+        edgeByPipe = move(byPipe);
+    }
+};
+
+#endif
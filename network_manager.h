@@ -1,291 +1,393 @@
-#ifndef NETWORK_MANAGER_H
-#define NETWORK_MANAGER_H
-
-#include "pipe_manager.h"
-#include "compress_manager.h"
-#include <vector>
-#include <map>
-#include <set>
-#include <algorithm>
-#include <iostream>
-#include <cmath>
-#include <queue>
-#include <limits>
-#include <functional>
-
-using namespace std;
-
-class NetworkManager {
-private:
-    PipeManager& pipeManager;
-    CompressManager& compressManager;
-
-public:
-    NetworkManager(PipeManager& pm, CompressManager& cm) 
-        : pipeManager(pm), compressManager(cm) {}
-
-    // --- ВСПОМОГАТЕЛЬНЫЕ ФОРМУЛЫ ---
-
-    // Расчет пропускной способности трубы
-    // Формула: sqrt(d^5 / l). 
-    // Результат делим на коэффициент, чтобы цифры были читаемыми (условные единицы)
-    double CalculateCapacity(const Pipe& p) {
-        if (p.repair) return 0.0; // Если в ремонте, поток 0
-        
-        // Диаметр в мм, длина в км. 
-        // Для физической точности нужно приводить к одной СИ, но для оценки достаточно пропорции.
-        // d^5 растет очень быстро, используем double.
-        double val = sqrt(pow(p.diametr, 5) / p.length);
-        return round(val / 100.0); // Скалируем для удобства чтения
-    }
-
-    // Расчет веса ребра (для кратчайшего пути)
-    double CalculateWeight(const Pipe& p) {
-        if (p.repair) return numeric_limits<double>::infinity(); // Бесконечный путь
-        return p.length;
-    }
-
-    // --- ОТОБРАЖЕНИЕ ---
-    void DisplayNetwork() {
-        cout << "\n===== Gas Transport Network =====\n";
-        bool hasConnections = false;
-        
-        auto& stations = compressManager.GetAll();
-        map<int, string> csNames;
-        for(const auto& cs : stations) csNames[cs.id] = cs.name;
-
-        for (const auto& pipe : pipeManager.GetAll()) {
-            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0) {
-                cout << "CS " << pipe.source_cs_id << " -> CS " << pipe.dest_cs_id
-                     << " | Pipe ID: " << pipe.id 
-                     << ", L: " << pipe.length << "km"
-                     << ", D: " << pipe.diametr << "mm"
-                     << (pipe.repair ? " [REPAIR]" : "")
-                     << " | MaxFlow: " << CalculateCapacity(pipe) 
-                     << "\n";
-                hasConnections = true;
-            }
-        }
-        if (!hasConnections) cout << "No active connections.\n";
-    }
-
-    // --- АЛГОРИТМ 1: КРАТЧАЙШИЙ ПУТЬ (Дейкстра) ---
-    void FindShortestPath(int startId, int endId) {
-        map<int, vector<int>> adjPipes; // CS_ID -> Список ID труб, исходящих из неё
-        
-        // Строим граф смежности
-        for (const auto& pipe : pipeManager.GetAll()) {
-            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0 && !pipe.repair) {
-                adjPipes[pipe.source_cs_id].push_back(pipe.id);
-            }
-        }
-
-        // dist[id] - минимальное расстояние от старта до id
-        map<int, double> dist;
-        map<int, int> parentPipe; // Какую трубу использовали, чтобы прийти
-        map<int, int> parentNode; // Из какого узла пришли
-
-        // Инициализация бесконечностью
-        for (const auto& cs : compressManager.GetAll()) {
-            dist[cs.id] = numeric_limits<double>::infinity();
-        }
-
-        if (dist.find(startId) == dist.end() || dist.find(endId) == dist.end()) {
-            cout << "Error: Start or End CS ID not found.\n";
-            return;
-        }
-
-        dist[startId] = 0;
-        // Priority Queue хранит пары <Distance, NodeID>, сортировка по возрастанию (через greater)
-        priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> pq;
-        pq.push({0, startId});
-
-        while (!pq.empty()) {
-            double d = pq.top().first;
-            int u = pq.top().second;
-            pq.pop();
-
-            if (d > dist[u]) continue;
-            if (u == endId) break; // Дошли до цели
-
-            // Проходим по всем трубам, выходящим из u
-            for (int pipeId : adjPipes[u]) {
-                Pipe* p = pipeManager.FindById(pipeId);
-                int v = p->dest_cs_id;
-                double weight = p->length;
-
-                if (dist[u] + weight < dist[v]) {
-                    dist[v] = dist[u] + weight;
-                    parentPipe[v] = pipeId;
-                    parentNode[v] = u;
-                    pq.push({dist[v], v});
-                }
-            }
-        }
-
-        // Восстановление пути
-        if (dist[endId] == numeric_limits<double>::infinity()) {
-            cout << "\nResult: No path exists between CS " << startId << " and CS " << endId << ".\n";
-        } else {
-            cout << "\n===== Shortest Path Result =====\n";
-            cout << "Total Length: " << dist[endId] << " km\n";
-            cout << "Path: ";
-            
-            vector<int> path;
-            int curr = endId;
-            while (curr != startId) {
-                path.push_back(curr);
-                curr = parentNode[curr];
-            }
-            path.push_back(startId);
-            reverse(path.begin(), path.end());
-
-            for (size_t i = 0; i < path.size(); i++) {
-                cout << path[i];
-                if (i < path.size() - 1) {
-                    // Находим трубу между узлами для красоты вывода
-                    cout << " --(Pipe " << parentPipe[path[i+1]] << ")--> ";
-                }
-            }
-            cout << "\n";
-        }
-    }
-
-    // --- АЛГОРИТМ 2: МАКСИМАЛЬНЫЙ ПОТОК (Эдмондс-Карп) ---
-    void CalculateMaxFlow(int source, int sink) {
-        // Строим матрицу пропускных способностей
-        // capacity[u][v] = суммарная пропускная способность труб от u к v
-        map<int, map<int, double>> capacity;
-        // Список смежности для BFS (включает и обратные ребра с 0 емкостью изначально)
-        map<int, vector<int>> graph;
-
-        // Заполняем граф
-        for (const auto& pipe : pipeManager.GetAll()) {
-            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0) {
-                int u = pipe.source_cs_id;
-                int v = pipe.dest_cs_id;
-                double cap = CalculateCapacity(pipe);
-                
-                if (cap > 0) {
-                    if (capacity[u][v] == 0 && capacity[v][u] == 0) {
-                        graph[u].push_back(v);
-                        graph[v].push_back(u); // Для остаточного графа
-                    }
-                    capacity[u][v] += cap;
-                }
-            }
-        }
-
-        if (graph.find(source) == graph.end() || graph.find(sink) == graph.end()) {
-             cout << "Error: Source or Sink not connected to network.\n";
-             return;
-        }
-
-        double maxFlow = 0;
-        
-        while (true) {
-            // BFS для поиска пути в остаточном графе
-            map<int, int> parent;
-            map<int, bool> visited;
-            queue<int> q;
-            
-            q.push(source);
-            visited[source] = true;
-            parent[source] = -1;
-
-            bool pathFound = false;
-            while (!q.empty()) {
-                int u = q.front();
-                q.pop();
-
-                if (u == sink) {
-                    pathFound = true;
-                    break;
-                }
-
-                for (int v : graph[u]) {
-                    if (!visited[v] && capacity[u][v] > 0) {
-                        parent[v] = u;
-                        visited[v] = true;
-                        q.push(v);
-                    }
-                }
-            }
-
-            if (!pathFound) break;
-
-            // Ищем минимальную пропускную способность на найденном пути
-            double pathFlow = numeric_limits<double>::infinity();
-            int curr = sink;
-            while (curr != source) {
-                int prev = parent[curr];
-                pathFlow = min(pathFlow, capacity[prev][curr]);
-                curr = prev;
-            }
-
-            // Обновляем остаточный граф
-            curr = sink;
-            while (curr != source) {
-                int prev = parent[curr];
-                capacity[prev][curr] -= pathFlow;
-                capacity[curr][prev] += pathFlow;
-                curr = prev;
-            }
-
-            maxFlow += pathFlow;
-        }
-
-        cout << "\n===== Max Flow Result =====\n";
-        cout << "Max Flow from CS " << source << " to CS " << sink << ": " << maxFlow << " (approx. units)\n";
-    }
-
-    // --- Топологическая сортировка (оставляем для совместимости) ---
-    vector<int> TopologicalSort() {
-        map<int, vector<int>> adj;
-        set<int> nodes;
-        for (const auto& pipe : pipeManager.GetAll()) {
-            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0) {
-                adj[pipe.source_cs_id].push_back(pipe.dest_cs_id);
-                nodes.insert(pipe.source_cs_id);
-                nodes.insert(pipe.dest_cs_id);
-            }
-        }
-
-        if (nodes.empty()) return {};
-
-        map<int, int> visited; 
-        vector<int> result;
-        bool hasCycle = false;
-
-        function<void(int)> dfs = [&](int u) {
-            visited[u] = 1; 
-            for (int v : adj[u]) {
-                if (visited[v] == 1) { hasCycle = true; return; }
-                if (visited[v] == 0) {
-                    dfs(v);
-                    if (hasCycle) return;
-                }
-            }
-            visited[u] = 2; 
-            result.push_back(u);
-        };
-
-        for (int node : nodes) {
-            if (visited[node] == 0) {
-                dfs(node);
-                if (hasCycle) break;
-            }
-        }
-
-        if (hasCycle) {
-            cout << "\nERROR: Cycle detected! Topo sort impossible.\n";
-            return {};
-        }
-        reverse(result.begin(), result.end());
-        return result;
-    }
-    
-    void DisconnectPipe(int pipeId) { pipeManager.UnlinkPipe(pipeId); }
-};
-
+#ifndef NETWORK_MANAGER_H
+#define NETWORK_MANAGER_H
+
+#include "pipe_manager.h"
+#include "compress_manager.h"
+#include "network_graph.h"
+#include "path_engines.h"
+#include "task_scheduler.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+struct TopologicalSortResult {
+    vector<int> order;       // ID КС в топологическом порядке
+    vector<int> cyclePipes;  // ID труб найденного цикла (по направлению потока)
+
+    bool HasCycle() const { return !cyclePipes.empty(); }
+};
+
+class NetworkManager {
+private:
+    PipeManager& pipeManager;
+    CompressManager& compressManager;
+
+    // Граф строится один раз и перестраивается только при изменении структуры сети;
+    // переключение ремонта применяется к готовому графу по журналу PipeManager
+    NetworkGraph graph;
+    bool graphBuilt = false;
+    size_t graphStructure = 0;
+    size_t graphRepairCursor = 0;
+    size_t graphVersion = 0;        // растет при любом изменении графа
+
+    // Буферы поиска для одиночных запросов и иерархия сжатия (создаются по требованию)
+    PathEngines engines;
+    size_t pathSearchStructure = 0;
+    size_t landmarkVersion = 0;
+    size_t hierarchyStructure = 0;
+    size_t hierarchyRepairCursor = 0;
+
+    // Найденные максимальные потоки по парам (исток, сток). Пока ребра в сеть не добавлялись,
+    // решение донастраивается по журналу изменений пропускной способности PipeManager
+    struct FlowCacheEntry {
+        unique_ptr<MaxFlowSolver> solver;
+        MaxFlowAlgorithm algorithm;
+        size_t capacityCursor = 0;
+    };
+    map<pair<int, int>, FlowCacheEntry> flowCache;
+    size_t flowCacheGrowth = 0;
+    static constexpr size_t FLOW_CACHE_LIMIT = 16;
+
+    // Рабочие буферы топологической сортировки
+    vector<int> topoState;
+    vector<int> topoCursor;
+    vector<int> topoParentEdge;
+    vector<int> topoStack;
+
+public:
+    NetworkManager(PipeManager& pm, CompressManager& cm) 
+        : pipeManager(pm), compressManager(cm) {}
+
+    // --- ВСПОМОГАТЕЛЬНЫЕ ФОРМУЛЫ ---
+
+    // Расчет пропускной способности трубы
+    // Формула: sqrt(d^5 / l). 
+    // Результат делим на коэффициент, чтобы цифры были читаемыми (условные единицы).
+    // Шаблон: подходит и для Pipe, и для записи отображенного снимка (PipeRecord)
+    template<typename PipeT>
+    static double CalculateCapacity(const PipeT& p) {
+        if (p.repair) return 0.0; // Если в ремонте, поток 0
+        
+        // Диаметр в мм, длина в км. 
+        // Для физической точности нужно приводить к одной СИ, но для оценки достаточно пропорции.
+        // d^5 растет очень быстро, используем double.
+        double val = sqrt(pow(p.diametr, 5) / p.length);
+        return round(val / 100.0); // Скалируем для удобства чтения
+    }
+
+    // Расчет веса ребра (для кратчайшего пути)
+    template<typename PipeT>
+    static double CalculateWeight(const PipeT& p) {
+        if (p.repair) return numeric_limits<double>::infinity(); // Бесконечный путь
+        return p.length;
+    }
+
+    // Актуальный CSR-граф сети, общий для всех алгоритмов
+    const NetworkGraph& GetGraph() {
+        auto capacity = [](const auto& p) { return CalculateCapacity(p); };
+        const PipeChangeLog& repairLog = pipeManager.GetRepairLog();
+        if (!graphBuilt || graphStructure != pipeManager.GetStructureVersion() || graphRepairCursor < repairLog.Begin()) {
+            // С колонками граф строится без обращения к объектам Pipe
+            if (const PipeColumns* columns = pipeManager.Columns()) graph.Build(columns->Rows(), capacity);
+            else graph.Build(pipeManager.GetAll(), capacity);
+            graphBuilt = true;
+            graphStructure = pipeManager.GetStructureVersion();
+            graphRepairCursor = repairLog.End();
+            graphVersion++;
+        } else if (graphRepairCursor < repairLog.End()) {
+            for (; graphRepairCursor < repairLog.End(); graphRepairCursor++) {
+                const Pipe* p = pipeManager.FindById(repairLog[graphRepairCursor]);
+                if (p) graph.UpdateRepair(*p, capacity);
+            }
+            graphVersion++;
+        }
+        return graph;
+    }
+
+    // Предварительная обработка для быстрых маршрутов (иерархия сжатия).
+    // При смене структуры сети строится заново, при переключении ремонта - донастраивается.
+    // Превысившая бюджет ребер иерархия (Ready() == false) до смены структуры не перестраивается.
+    const ContractionHierarchy& PrepareContractionHierarchy() {
+        const NetworkGraph& g = GetGraph();
+        const PipeChangeLog& repairLog = pipeManager.GetRepairLog();
+        if (!engines.hierarchy || hierarchyStructure != graphStructure || hierarchyRepairCursor < repairLog.Begin()) {
+            engines.hierarchy.reset(new ContractionHierarchy());
+            engines.hierarchy->Build(g);
+            hierarchyStructure = graphStructure;
+            hierarchyRepairCursor = repairLog.End();
+        }
+        for (; hierarchyRepairCursor < repairLog.End(); hierarchyRepairCursor++) {
+            int e = g.EdgeOfPipe(repairLog[hierarchyRepairCursor]);
+            if (e != -1 && engines.hierarchy->Ready()) engines.hierarchy->UpdateGraphEdge(g, e);
+        }
+        return *engines.hierarchy;
+    }
+
+    // --- ОТОБРАЖЕНИЕ ---
+    void DisplayNetwork() { PrintNetwork(pipeManager.GetAll()); }
+
+    // Общий вывод для менеджеров и для отображенного снимка
+    template<typename PipeRange>
+    static void PrintNetwork(const PipeRange& pipes) {
+        cout << "\n===== Gas Transport Network =====\n";
+        bool hasConnections = false;
+
+        for (const auto& pipe : pipes) {
+            if (pipe.source_cs_id != 0 && pipe.dest_cs_id != 0) {
+                cout << "CS " << pipe.source_cs_id << " -> CS " << pipe.dest_cs_id
+                     << " | Pipe ID: " << pipe.id 
+                     << ", L: " << pipe.length << "km"
+                     << ", D: " << pipe.diametr << "mm"
+                     << (pipe.repair ? " [REPAIR]" : "")
+                     << " | MaxFlow: " << CalculateCapacity(pipe) 
+                     << "\n";
+                hasConnections = true;
+            }
+        }
+        if (!hasConnections) cout << "No active connections.\n";
+    }
+
+    // --- АЛГОРИТМ 1: КРАТЧАЙШИЙ ПУТЬ (Дейкстра, встречный поиск, ALT) ---
+    ShortestPathResult ComputeShortestPath(int startId, int endId, PathAlgorithm algorithm = PathAlgorithm::Dijkstra) {
+        const NetworkGraph& g = GetGraph();
+        // Буферы зависят только от структуры, расстояния до ориентиров - и от ремонта
+        if (pathSearchStructure != graphStructure) {
+            engines.ResetBuffers();
+            pathSearchStructure = graphStructure;
+        }
+        if (landmarkVersion != graphVersion) {
+            engines.landmarks.reset();
+            landmarkVersion = graphVersion;
+        }
+        return engines.ShortestPath(g, startId, endId, algorithm,
+            [this](int id) { return compressManager.FindById(id) != nullptr; },
+            [this]() -> ContractionHierarchy& { PrepareContractionHierarchy(); return *engines.hierarchy; });
+    }
+
+    void FindShortestPath(int startId, int endId, PathAlgorithm algorithm = PathAlgorithm::Dijkstra) {
+        ShortestPathResult result = ComputeShortestPath(startId, endId, algorithm);
+        PrintShortestPath(result, startId, endId, GetGraph());
+    }
+
+    static void PrintShortestPath(const ShortestPathResult& result, int startId, int endId, const NetworkGraph& g) {
+        if (!result.error.empty()) {
+            cout << "Error: " << result.error << "\n";
+            return;
+        }
+
+        if (!result.found) {
+            cout << "\nResult: No path exists between CS " << startId << " and CS " << endId << ".\n";
+        } else {
+            cout << "\n===== Shortest Path Result =====\n";
+            cout << "Total Length: " << result.length << " km\n";
+            cout << "Path: " << result.stations[0];
+            for (size_t i = 0; i < result.pipes.size(); i++) {
+                cout << " --(Pipe " << result.pipes[i] << ")--> " << result.stations[i + 1];
+            }
+            cout << "\n";
+        }
+        cout << "Settled vertices: " << result.settled << " of " << g.VertexCount() << "\n";
+    }
+
+    // Матрица кратчайших расстояний от каждого источника до каждой цели.
+    // Строки считаются на рабочих scheduler (по умолчанию общий), граф общий и только читается.
+    // Пустой targetIds - квадратная матрица по sourceIds.
+    DistanceMatrix ComputeDistanceMatrix(const vector<int>& sourceIds, const vector<int>& targetIds = {},
+                                         TaskScheduler& scheduler = TaskScheduler::Shared()) {
+        DistanceMatrix matrix;
+        matrix.sources = sourceIds;
+        matrix.targets = targetIds.empty() ? sourceIds : targetIds;
+        size_t rows = matrix.sources.size();
+        size_t cols = matrix.targets.size();
+        matrix.distance.assign(rows * cols, numeric_limits<double>::infinity());
+        matrix.predecessor.assign(rows * cols, -1);
+
+        const NetworkGraph& g = GetGraph();
+        vector<int> targetIndex(cols);
+        for (size_t j = 0; j < cols; j++) targetIndex[j] = g.IndexOf(matrix.targets[j]);
+
+        // Буферы поиска - на участок, строки внутри участка переиспользуют их
+        scheduler.ParallelFor(0, rows, scheduler.GrainFor(rows), [&](size_t lo, size_t hi) {
+            DijkstraSearch search(g);
+            for (size_t row = lo; row < hi; row++) {
+                int s = g.IndexOf(matrix.sources[row]);
+                double* distRow = &matrix.distance[row * cols];
+                int* predRow = &matrix.predecessor[row * cols];
+                for (size_t j = 0; j < cols; j++) {
+                    if (matrix.targets[j] == matrix.sources[row]) distRow[j] = 0;
+                }
+                if (s == -1) continue;
+
+                search.Run(s);
+                for (size_t j = 0; j < cols; j++) {
+                    int t = targetIndex[j];
+                    if (t == -1 || t == s) continue;
+                    distRow[j] = search.Distance(t);
+                    int e = search.ParentEdge(t);
+                    if (e != -1) predRow[j] = g.stationIds[g.edgeFrom[e]];
+                }
+            }
+        }, "distance-matrix");
+        return matrix;
+    }
+
+    // Числа потоков для замера масштабирования: 1, 2, 4, ... и число ядер
+    static vector<int> BenchmarkThreadCounts() {
+        int maxThreads = (int)max(1u, thread::hardware_concurrency());
+        vector<int> counts;
+        for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+        counts.push_back(maxThreads);
+        return counts;
+    }
+
+    // Время (мс) расчета квадратной матрицы по ids для каждого числа потоков.
+    // На каждое число - свой планировщик с таким числом рабочих; граф и потоки
+    // создаются до замера, чтобы не попасть в него. timing, если задан, ставится хуком
+    // замера на каждый из этих планировщиков.
+    vector<double> BenchmarkDistanceMatrix(const vector<int>& ids, const vector<int>& threadCounts,
+                                           const TaskScheduler::TimingHook& timing = nullptr) {
+        vector<double> times;
+        if (ids.empty()) return times;
+        ComputeDistanceMatrix({ids[0]});
+        for (int t : threadCounts) {
+            TaskScheduler scheduler(t);
+            scheduler.SetTimingHook(timing);
+            auto started = chrono::steady_clock::now();
+            ComputeDistanceMatrix(ids, {}, scheduler);
+            times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - started).count());
+        }
+        return times;
+    }
+
+    // --- АЛГОРИТМ 2: МАКСИМАЛЬНЫЙ ПОТОК (Диниц / push-relabel) ---
+    MaxFlowResult ComputeMaxFlow(int source, int sink, MaxFlowAlgorithm algorithm = MaxFlowAlgorithm::Dinic) {
+        MaxFlowResult result;
+        const NetworkGraph& g = GetGraph();
+        int s, t;
+        if (!PathEngines::FlowEnds(g, source, sink, s, t, result)) return result;
+
+        if (flowCacheGrowth != pipeManager.GetGrowthVersion()) {
+            flowCache.clear();
+            flowCacheGrowth = pipeManager.GetGrowthVersion();
+        }
+
+        const PipeChangeLog& capacityLog = pipeManager.GetCapacityLog();
+        auto it = flowCache.find({source, sink});
+        if (it != flowCache.end() && it->second.algorithm == algorithm) {
+            FlowCacheEntry& entry = it->second;
+            bool repaired = entry.capacityCursor >= capacityLog.Begin();   // иначе журнал уже обрезан
+            for (; repaired && entry.capacityCursor < capacityLog.End(); entry.capacityCursor++) {
+                int pipeId = capacityLog[entry.capacityCursor];
+                const Pipe* p = pipeManager.FindById(pipeId);
+                double capacity = (p && g.EdgeOfPipe(pipeId) != -1) ? CalculateCapacity(*p) : 0.0;
+                repaired = entry.solver->UpdatePipeCapacity(pipeId, capacity);
+            }
+            if (repaired) {
+                entry.solver->FillResult(result);
+                return result;
+            }
+            flowCache.erase(it);
+        }
+
+        if (flowCache.size() >= FLOW_CACHE_LIMIT) flowCache.clear();
+        FlowCacheEntry& entry = flowCache[{source, sink}];
+        entry.solver.reset(new MaxFlowSolver(g));
+        entry.algorithm = algorithm;
+        entry.capacityCursor = capacityLog.End();
+        entry.solver->Solve(s, t, algorithm);
+        entry.solver->FillResult(result);
+        return result;
+    }
+
+    void CalculateMaxFlow(int source, int sink, MaxFlowAlgorithm algorithm = MaxFlowAlgorithm::Dinic) {
+        MaxFlowResult result = ComputeMaxFlow(source, sink, algorithm);
+        PrintMaxFlow(result, source, sink, GetGraph());
+    }
+
+    static void PrintMaxFlow(const MaxFlowResult& result, int source, int sink, const NetworkGraph& g) {
+        if (!result.Ok()) {
+            cout << "Error: " << result.error << "\n";
+            return;
+        }
+
+        cout << "\n===== Max Flow Result =====\n";
+        cout << "Max Flow from CS " << source << " to CS " << sink << ": " << result.totalFlow << " (approx. units)\n";
+
+        if (!result.pipeFlows.empty()) {
+            cout << "Pipe flows:\n";
+            for (const auto& pf : result.pipeFlows) {
+                int e = g.EdgeOfPipe(pf.first);
+                cout << "  Pipe " << pf.first << " (CS " << g.stationIds[g.edgeFrom[e]] << " -> CS " << g.stationIds[g.edgeTo[e]] << "): "
+                     << pf.second << " / " << g.edgeCapacity[e] << "\n";
+            }
+        }
+        cout << "Min cut pipes:";
+        for (int id : result.minCutPipes) cout << " " << id;
+        cout << "\n";
+    }
+
+    // --- Топологическая сортировка (оставляем для совместимости) ---
+    TopologicalSortResult TopologicalSort() {
+        TopologicalSortResult result;
+        const NetworkGraph& g = GetGraph();
+        int n = g.VertexCount();
+        if (n == 0) return result;
+
+        // Итеративный DFS: стек вершин и позиция очередного исходящего ребра
+        topoState.assign(n, 0);        // 0 - не посещена, 1 - в стеке, 2 - обработана
+        topoCursor.assign(n, 0);
+        topoParentEdge.assign(n, -1);
+        topoStack.clear();
+        result.order.reserve(n);
+
+        for (int root = 0; root < n; root++) {
+            if (topoState[root] != 0) continue;
+            topoState[root] = 1;
+            topoCursor[root] = g.outStart[root];
+            topoStack.push_back(root);
+
+            while (!topoStack.empty()) {
+                int u = topoStack.back();
+                if (topoCursor[u] == g.outStart[u + 1]) {
+                    topoState[u] = 2;
+                    result.order.push_back(g.stationIds[u]);
+                    topoStack.pop_back();
+                    continue;
+                }
+                int e = topoCursor[u]++;
+                int v = g.edgeTo[e];
+                if (topoState[v] == 1) {
+                    // Обратное ребро u -> v: цикл v -> ... -> u -> v по родительским ребрам
+                    for (int w = u; w != v; w = g.edgeFrom[topoParentEdge[w]]) {
+                        result.cyclePipes.push_back(g.edgePipe[topoParentEdge[w]]);
+                    }
+                    reverse(result.cyclePipes.begin(), result.cyclePipes.end());
+                    result.cyclePipes.push_back(g.edgePipe[e]);
+                    result.order.clear();
+                    return result;
+                }
+                if (topoState[v] == 0) {
+                    topoState[v] = 1;
+                    topoCursor[v] = g.outStart[v];
+                    topoParentEdge[v] = e;
+                    topoStack.push_back(v);
+                }
+            }
+        }
+
+        reverse(result.order.begin(), result.order.end());
+        return result;
+    }
+    
+    void DisconnectPipe(int pipeId) { pipeManager.UnlinkPipe(pipeId); }
+};
+
 #endif
\ No newline at end of file
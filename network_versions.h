@@ -0,0 +1,282 @@
+#ifndef NETWORK_VERSIONS_H
+#define NETWORK_VERSIONS_H
+
+#include "pipe_manager.h"
+#include "compress_manager.h"
+#include "network_manager.h"
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+using namespace std;
+
+// Неизменяемая копия элементов менеджера с поиском по id. Элементы разложены блоками
+// по диапазонам id: следующая версия перечитывает только блоки с изменениями,
+// остальные разделяет с предыдущей.
+template<typename T>
+class VersionTable {
+public:
+    static constexpr size_t BLOCK_BITS = 10;
+
+private:
+    using Block = vector<T>;   // элементы блока по возрастанию id
+    vector<shared_ptr<const Block>> blocks;
+    size_t count = 0;
+
+public:
+    const T* Find(int id) const {
+        size_t b = (size_t)id >> BLOCK_BITS;
+        if (id < 0 || b >= blocks.size() || !blocks[b]) return nullptr;
+        const Block& block = *blocks[b];
+        auto it = lower_bound(block.begin(), block.end(), id, [](const T& item, int key) { return item.id < key; });
+        return it != block.end() && it->id == id ? &*it : nullptr;
+    }
+
+    size_t size() const { return count; }
+
+    template<typename Visitor>
+    void ForEach(Visitor visit) const {
+        for (const auto& block : blocks) {
+            if (block) for (const T& item : *block) visit(item);
+        }
+    }
+
+    // Полное построение по менеджеру
+    static shared_ptr<const VersionTable> Build(const GenericManager<T>& manager) {
+        auto table = make_shared<VersionTable>();
+        vector<Block> filled(BlockCount(manager));
+        for (const T& item : manager.GetAll()) filled[(size_t)item.id >> BLOCK_BITS].push_back(item);
+        table->blocks.resize(filled.size());
+        for (size_t b = 0; b < filled.size(); b++) {
+            if (filled[b].empty()) continue;
+            // Восстановленные из файла элементы могут идти не по порядку id
+            if (!is_sorted(filled[b].begin(), filled[b].end(), [](const T& x, const T& y) { return x.id < y.id; })) {
+                sort(filled[b].begin(), filled[b].end(), [](const T& x, const T& y) { return x.id < y.id; });
+            }
+            table->count += filled[b].size();
+            table->blocks[b] = make_shared<const Block>(move(filled[b]));
+        }
+        return table;
+    }
+
+    // Новая версия: блоки из dirty перечитываются из менеджера, остальные общие с this
+    shared_ptr<const VersionTable> Update(const GenericManager<T>& manager, vector<size_t>& dirty) const {
+        auto table = make_shared<VersionTable>(*this);
+        table->blocks.resize(max(blocks.size(), BlockCount(manager)));
+        sort(dirty.begin(), dirty.end());
+        dirty.erase(unique(dirty.begin(), dirty.end()), dirty.end());
+        for (size_t b : dirty) {
+            if (b >= table->blocks.size()) continue;
+            if (table->blocks[b]) table->count -= table->blocks[b]->size();
+            Block block;
+            int first = (int)(b << BLOCK_BITS);
+            for (int id = first; id < first + (int)(size_t(1) << BLOCK_BITS); id++) {
+                if (const T* item = manager.FindById(id)) block.push_back(*item);
+            }
+            table->count += block.size();
+            table->blocks[b] = block.empty() ? nullptr : make_shared<const Block>(move(block));
+        }
+        return table;
+    }
+
+private:
+    static size_t BlockCount(const GenericManager<T>& manager) {
+        return ((size_t)manager.NextId() >> BLOCK_BITS) + 1;
+    }
+};
+
+// Опубликованная версия сети. После публикации не меняется, поэтому читается из любого
+// числа потоков без блокировок. Неизмененные части разделяются с предыдущей версией:
+// таблицы - по блокам id, граф - структурой и блоками ремонта.
+struct NetworkVersion {
+    uint64_t epoch = 0;
+    shared_ptr<const VersionTable<Pipe>> pipes;
+    shared_ptr<const VersionTable<Compress>> stations;
+    shared_ptr<const NetworkGraph> graph;
+};
+
+// Модель конкурентного доступа: один писатель за раз, читатели на опубликованных версиях (RCU).
+// Изменения менеджеров выполняются внутри Write под мьютексом писателей; после изменения
+// писатель публикует новую версию атомарной заменой указателя. Читатель берет текущую версию
+// через Acquire и держит ее сколько нужно: писатели его не ждут, а старая версия
+// освобождается, когда ее отпустит последний читатель.
+class VersionedNetwork {
+private:
+    PipeManager& pipeManager;
+    CompressManager& compressManager;
+
+    // Подписчик: собирает блоки таблицы, изменившиеся с последней публикации.
+    // Очистка или слишком много изменений - таблица строится заново.
+    template<typename T>
+    struct DirtyTap : ManagerObserver<T> {
+        static constexpr size_t MAX_BLOCKS = 4096;
+        bool all = true;
+        vector<size_t> blocks;
+
+        bool Dirty() const { return all || !blocks.empty(); }
+        void Mark(int id) {
+            if (all) return;
+            if (blocks.size() >= MAX_BLOCKS) { all = true; blocks.clear(); return; }
+            blocks.push_back((size_t)id >> VersionTable<T>::BLOCK_BITS);
+        }
+        void Reset() { all = false; blocks.clear(); }
+
+        void OnItemAdded(const T& item) override { Mark(item.id); }
+        void OnItemChanged(const T& item) override { Mark(item.id); }
+        void OnItemDeleted(int id) override { Mark(id); }
+        void OnItemsCleared() override { all = true; blocks.clear(); }
+    };
+
+    DirtyTap<Pipe> pipeTap;
+    DirtyTap<Compress> stationTap;
+
+    mutex writeMutex;
+    shared_ptr<const NetworkVersion> published;   // доступ только через atomic_load/atomic_store
+    uint64_t epoch = 0;
+
+    // Для донастройки графа по журналу ремонта вместо перестройки
+    size_t graphStructure = 0;
+    size_t graphRepairCursor = 0;
+
+public:
+    VersionedNetwork(PipeManager& pm, CompressManager& cm) : pipeManager(pm), compressManager(cm) {
+        pipeManager.AddObserver(&pipeTap);
+        compressManager.AddObserver(&stationTap);
+        lock_guard<mutex> lock(writeMutex);
+        Publish();
+    }
+
+    VersionedNetwork(const VersionedNetwork&) = delete;
+    VersionedNetwork& operator=(const VersionedNetwork&) = delete;
+
+    ~VersionedNetwork() {
+        pipeManager.RemoveObserver(&pipeTap);
+        compressManager.RemoveObserver(&stationTap);
+    }
+
+    // Изменение сети: write(pipeManager, compressManager) выполняется под мьютексом писателей,
+    // затем публикуется новая версия. Несколько правок в одном вызове дают одну публикацию.
+    template<typename Writer>
+    auto Write(Writer write) -> decltype(write(declval<PipeManager&>(), declval<CompressManager&>())) {
+        lock_guard<mutex> lock(writeMutex);
+        struct PublishOnExit {
+            VersionedNetwork* self;
+            ~PublishOnExit() { self->Publish(); }
+        } publishOnExit{this};
+        return write(pipeManager, compressManager);
+    }
+
+    // Текущая версия; не блокируется
+    shared_ptr<const NetworkVersion> Acquire() const { return atomic_load(&published); }
+
+    uint64_t Epoch() const { return Acquire()->epoch; }
+
+private:
+    // Вызывается под writeMutex
+    void Publish() {
+        if (!pipeTap.Dirty() && !stationTap.Dirty()) return;
+        shared_ptr<const NetworkVersion> previous = atomic_load(&published);
+        auto next = make_shared<NetworkVersion>();
+        next->epoch = ++epoch;
+
+        next->pipes = PublishTable(pipeManager, pipeTap, previous ? previous->pipes : nullptr);
+        next->stations = PublishTable(compressManager, stationTap, previous ? previous->stations : nullptr);
+        next->graph = pipeTap.Dirty() || !previous ? BuildGraph(previous ? previous->graph : nullptr) : previous->graph;
+
+        pipeTap.Reset();
+        stationTap.Reset();
+        atomic_store(&published, shared_ptr<const NetworkVersion>(move(next)));
+    }
+
+    template<typename T>
+    static shared_ptr<const VersionTable<T>> PublishTable(const GenericManager<T>& manager, DirtyTap<T>& tap,
+                                                          const shared_ptr<const VersionTable<T>>& previous) {
+        if (tap.all || !previous) return VersionTable<T>::Build(manager);
+        if (tap.blocks.empty()) return previous;
+        return previous->Update(manager, tap.blocks);
+    }
+
+    // Если менялся только ремонт, новая версия графа разделяет структуру с предыдущей
+    // и копирует только блоки ремонта с измененными трубами
+    shared_ptr<const NetworkGraph> BuildGraph(const shared_ptr<const NetworkGraph>& previous) {
+        auto capacity = [](const auto& p) { return NetworkManager::CalculateCapacity(p); };
+        const PipeChangeLog& repairLog = pipeManager.GetRepairLog();
+        if (previous && graphStructure == pipeManager.GetStructureVersion() && graphRepairCursor >= repairLog.Begin()) {
+            if (graphRepairCursor == repairLog.End()) return previous;
+            auto graph = make_shared<NetworkGraph>(*previous);
+            for (; graphRepairCursor < repairLog.End(); graphRepairCursor++) {
+                const Pipe* p = pipeManager.FindById(repairLog[graphRepairCursor]);
+                if (p) graph->UpdateRepair(*p, capacity);
+            }
+            return graph;
+        }
+
+        auto graph = make_shared<NetworkGraph>();
+        if (const PipeColumns* columns = pipeManager.Columns()) graph->Build(columns->Rows(), capacity);
+        else graph->Build(pipeManager.GetAll(), capacity);
+        graphStructure = pipeManager.GetStructureVersion();
+        graphRepairCursor = repairLog.End();
+        return graph;
+    }
+};
+
+// Запросы аналитика по закрепленной версии сети. Один объект - на один поток:
+// буферы поиска свои, версия общая. Pin переходит на последнюю опубликованную версию.
+class NetworkReader {
+private:
+    const VersionedNetwork& network;
+    shared_ptr<const NetworkVersion> version;
+
+    PathEngines engines;
+
+public:
+    explicit NetworkReader(const VersionedNetwork& versions) : network(versions), version(versions.Acquire()) {}
+
+    // true, если версия сменилась
+    bool Pin() {
+        shared_ptr<const NetworkVersion> latest = network.Acquire();
+        if (latest == version) return false;
+        if (latest->graph != version->graph) {
+            engines.ResetBuffers();
+            // Иерархия зависит только от структуры: если новая версия графа разделяет ее
+            // со старой, донастраиваются ребра со сменившимся ремонтом, иначе иерархия
+            // строится заново при следующем запросе
+            const NetworkGraph& next = *latest->graph;
+            ContractionHierarchy* ch = engines.hierarchy.get();
+            if (ch && next.SameStructure(*version->graph)) {
+                if (ch->Ready()) next.ForEachRepairChange(*version->graph, [&](int e) { ch->UpdateGraphEdge(next, e); });
+            } else {
+                engines.hierarchy.reset();
+            }
+        }
+        version = move(latest);
+        return true;
+    }
+
+    const NetworkVersion& Version() const { return *version; }
+    const NetworkGraph& GetGraph() const { return *version->graph; }
+
+    ShortestPathResult ComputeShortestPath(int startId, int endId, PathAlgorithm algorithm = PathAlgorithm::Dijkstra) {
+        const NetworkGraph& g = GetGraph();
+        return engines.ShortestPath(g, startId, endId, algorithm,
+            [this](int id) { return version->stations->Find(id) != nullptr; },
+            [this, &g]() -> ContractionHierarchy& {
+                if (!engines.hierarchy) {
+                    engines.hierarchy.reset(new ContractionHierarchy());
+                    engines.hierarchy->Build(g);
+                }
+                return *engines.hierarchy;
+            });
+    }
+
+    MaxFlowResult ComputeMaxFlow(int source, int sink, MaxFlowAlgorithm algorithm = MaxFlowAlgorithm::Dinic) {
+        return PathEngines::MaxFlow(GetGraph(), source, sink, algorithm);
+    }
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef PATH_ENGINES_H
+#define PATH_ENGINES_H
+
+#include "network_graph.h"
+#include "shortest_path.h"
+#include "contraction_hierarchy.h"
+#include "max_flow.h"
+#include <memory>
+
+using namespace std;
+
+// Поисковые движки одного графа сети и общая часть запросов: проверка станций и концов
+// потока, выбор алгоритма. NetworkManager, NetworkReader и SnapshotAnalyzer отличаются
+// только тем, откуда берут граф и когда сбрасывают буферы.
+// Буферы создаются при первом запросе и ссылаются на граф, поэтому после замены графа
+// или его структуры вызывается ResetBuffers. Один экземпляр - на один поток.
+struct PathEngines {
+    unique_ptr<DijkstraSearch> dijkstra;
+    unique_ptr<BidirectionalSearch> bidirectional;
+    unique_ptr<LandmarkSearch> landmarks;          // расстояния до ориентиров зависят и от ремонта
+    unique_ptr<ContractionHierarchy> hierarchy;    // строит и донастраивает владелец
+
+    void ResetBuffers() {
+        dijkstra.reset();
+        bidirectional.reset();
+        landmarks.reset();
+    }
+
+    // hasStation(id) - есть ли такая КС; prepareHierarchy() возвращает иерархию для g
+    // (вызывается только для PathAlgorithm::ContractionHierarchy). Если иерархия превысила
+    // бюджет ребер (Ready() == false), запрос выполняется встречным поиском.
+    template<typename HasStation, typename PrepareHierarchy>
+    ShortestPathResult ShortestPath(const NetworkGraph& g, int startId, int endId, PathAlgorithm algorithm,
+                                    HasStation hasStation, PrepareHierarchy prepareHierarchy) {
+        ShortestPathResult result;
+        if (!hasStation(startId) || !hasStation(endId)) {
+            result.error = "Start or End CS ID not found.";
+            return result;
+        }
+        if (startId == endId) {
+            result.found = true;
+            result.stations.push_back(startId);
+            return result;
+        }
+
+        int s = g.IndexOf(startId);
+        int t = g.IndexOf(endId);
+        if (s == -1 || t == -1) return result; // станция не подключена к сети
+
+        if (algorithm == PathAlgorithm::ContractionHierarchy) {
+            ContractionHierarchy& ch = prepareHierarchy();
+            if (ch.Ready()) {
+                ch.Query(g, s, t, result);
+                return result;
+            }
+            algorithm = PathAlgorithm::Bidirectional;
+        }
+
+        switch (algorithm) {
+        case PathAlgorithm::Bidirectional:
+            if (!bidirectional) bidirectional.reset(new BidirectionalSearch(g));
+            bidirectional->Run(s, t, result);
+            break;
+        case PathAlgorithm::ALT:
+            // Ориентиры считаются один раз на версию графа
+            if (!landmarks) landmarks.reset(new LandmarkSearch(g));
+            landmarks->Run(s, t, result);
+            break;
+        default:
+            if (!dijkstra) dijkstra.reset(new DijkstraSearch(g));
+            result.settled = dijkstra->Run(s, t);
+            dijkstra->ExtractPath(s, t, result);
+        }
+        return result;
+    }
+
+    // Проверка концов потока; при успехе s и t - их вершины в g
+    static bool FlowEnds(const NetworkGraph& g, int source, int sink, int& s, int& t, MaxFlowResult& result) {
+        if (source == sink) {
+            result.error = "Source and Sink must be different stations.";
+            return false;
+        }
+        s = g.IndexOf(source);
+        t = g.IndexOf(sink);
+        if (s == -1 || t == -1 || !g.HasFlowEdges(s) || !g.HasFlowEdges(t)) {
+            result.error = "Source or Sink not connected to network.";
+            return false;
+        }
+        return true;
+    }
+
+    // Поток без кэша решений: расчет с нуля по g
+    static MaxFlowResult MaxFlow(const NetworkGraph& g, int source, int sink, MaxFlowAlgorithm algorithm) {
+        MaxFlowResult result;
+        int s, t;
+        if (!FlowEnds(g, source, sink, s, t, result)) return result;
+        MaxFlowSolver solver(g);
+        solver.Solve(s, t, algorithm);
+        solver.FillResult(result);
+        return result;
+    }
+};
+
+#endif
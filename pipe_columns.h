@@ -0,0 +1,158 @@
+#ifndef PIPE_COLUMNS_H
+#define PIPE_COLUMNS_H
+
+#include "structs.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <limits>
+
+using namespace std;
+
+// Одна строка колоночного хранилища - только числовые поля трубы.
+// Поля названы как в Pipe, поэтому подходит для NetworkGraph::Build и формул расчета.
+struct PipeRow {
+    int id;
+    double length;
+    int diametr;
+    bool repair;
+    int source_cs_id;
+    int dest_cs_id;
+};
+
+// Колоночное (structure-of-arrays) зеркало труб PipeManager.
+// Позиция i совпадает со слотом трубы в PipeManager (SlotOf): удаленная труба оставляет
+// пустую строку до уплотнения менеджера. Фильтры и построение графа
+// читают только нужные массивы, не затрагивая строки km_mark.
+struct PipeColumns {
+    vector<int> id;
+    vector<double> length;
+    vector<int> diametr;
+    vector<uint64_t> repairBits;     // признак ремонта, бит на трубу
+    vector<int> source;
+    vector<int> dest;
+
+    // Километровые отметки лежат подряд в одной строке
+    string kmArena;
+    vector<uint32_t> kmOffset;
+    vector<uint32_t> kmLength;
+    size_t kmGarbage = 0;            // байты арены, на которые больше никто не ссылается
+
+    size_t Size() const { return id.size(); }
+
+    bool Repair(size_t i) const { return (repairBits[i >> 6] >> (i & 63)) & 1; }
+
+    void SetRepair(size_t i, bool value) {
+        uint64_t mask = uint64_t(1) << (i & 63);
+        if (value) repairBits[i >> 6] |= mask;
+        else repairBits[i >> 6] &= ~mask;
+    }
+
+    string_view KmMark(size_t i) const { return string_view(kmArena).substr(kmOffset[i], kmLength[i]); }
+
+    PipeRow Row(size_t i) const {
+        return {id[i], length[i], diametr[i], Repair(i), source[i], dest[i]};
+    }
+
+    void Reserve(size_t count) {
+        id.reserve(count);
+        length.reserve(count);
+        diametr.reserve(count);
+        repairBits.reserve((count + 63) / 64);
+        source.reserve(count);
+        dest.reserve(count);
+        kmOffset.reserve(count);
+        kmLength.reserve(count);
+    }
+
+    void Clear() {
+        id.clear();
+        length.clear();
+        diametr.clear();
+        repairBits.clear();
+        source.clear();
+        dest.clear();
+        kmArena.clear();
+        kmOffset.clear();
+        kmLength.clear();
+        kmGarbage = 0;
+    }
+
+    void Append(const Pipe& pipe) {
+        size_t i = id.size();
+        id.push_back(pipe.id);
+        length.push_back(pipe.length);
+        diametr.push_back(pipe.diametr);
+        source.push_back(pipe.source_cs_id);
+        dest.push_back(pipe.dest_cs_id);
+        if ((i >> 6) >= repairBits.size()) repairBits.push_back(0);
+        SetRepair(i, pipe.repair);
+        kmOffset.push_back((uint32_t)kmArena.size());
+        kmLength.push_back((uint32_t)pipe.km_mark.size());
+        kmArena += pipe.km_mark;
+    }
+
+    void Set(size_t i, const Pipe& pipe) {
+        length[i] = pipe.length;
+        diametr[i] = pipe.diametr;
+        source[i] = pipe.source_cs_id;
+        dest[i] = pipe.dest_cs_id;
+        SetRepair(i, pipe.repair);
+        if (KmMark(i) != pipe.km_mark) {
+            kmGarbage += kmLength[i];
+            kmOffset[i] = (uint32_t)kmArena.size();
+            kmLength[i] = (uint32_t)pipe.km_mark.size();
+            kmArena += pipe.km_mark;
+            CompactIfNeeded();
+        }
+    }
+
+    // Строка удаленной трубы (как пустой слот в GenericManager): не подключена и не проходит
+    // ни одного фильтра по значению (длина NaN, диаметр 0)
+    void ClearRow(size_t i) {
+        kmGarbage += kmLength[i];
+        id[i] = 0;
+        length[i] = numeric_limits<double>::quiet_NaN();
+        diametr[i] = 0;
+        source[i] = 0;
+        dest[i] = 0;
+        SetRepair(i, false);
+        kmOffset[i] = 0;
+        kmLength[i] = 0;
+        CompactIfNeeded();
+    }
+
+    // Перестройка арены, когда мусора в ней больше половины
+    void CompactIfNeeded() {
+        if (kmGarbage < 4096 || kmGarbage * 2 < kmArena.size()) return;
+        string arena;
+        arena.reserve(kmArena.size() - kmGarbage);
+        for (size_t i = 0; i < id.size(); i++) {
+            uint32_t offset = (uint32_t)arena.size();
+            arena.append(kmArena, kmOffset[i], kmLength[i]);
+            kmOffset[i] = offset;
+        }
+        kmArena.swap(arena);
+        kmGarbage = 0;
+    }
+
+    // Диапазон строк для range-for (элементы возвращаются по значению)
+    struct RowIterator {
+        const PipeColumns* columns;
+        size_t i;
+        PipeRow operator*() const { return columns->Row(i); }
+        RowIterator& operator++() { i++; return *this; }
+        bool operator!=(const RowIterator& other) const { return i != other.i; }
+    };
+
+    struct RowRange {
+        const PipeColumns* columns;
+        RowIterator begin() const { return {columns, 0}; }
+        RowIterator end() const { return {columns, columns->Size()}; }
+    };
+
+    RowRange Rows() const { return {this}; }
+};
+
+#endif
@@ -3,51 +3,243 @@
 
 #include "structs.h"
 #include "generic_manager.h"
+#include "pipe_columns.h"
+#include "secondary_index.h"
 #include <iomanip>
 #include <sstream>
+#include <map>
+#include <set>
 
 using namespace std;
 
+// Журнал id труб с абсолютными позициями записей. Потребитель хранит позицию следующей
+// непрочитанной записи. Журнал не растет без предела: когда он длиннее лимита, старшая
+// половина отбрасывается, и потребитель с позицией меньше Begin() перестраивает свои данные.
+class PipeChangeLog {
+private:
+    vector<int> entries;
+    size_t base = 0;    // позиция entries[0]
+
+public:
+    size_t Begin() const { return base; }
+    size_t End() const { return base + entries.size(); }
+    int operator[](size_t position) const { return entries[position - base]; }
+
+    void Push(int pipeId, size_t limit) {
+        entries.push_back(pipeId);
+        if (entries.size() <= limit) return;
+        size_t dropped = entries.size() / 2;
+        entries.erase(entries.begin(), entries.begin() + dropped);
+        base += dropped;
+    }
+
+    // Сброс при смене структуры; позиции продолжают расти
+    void Clear() {
+        base += entries.size();
+        entries.clear();
+    }
+};
+
 class PipeManager : public GenericManager<Pipe> {
+private:
+    // Пул свободных (неподключенных) труб: диаметр -> id по возрастанию
+    map<int, set<int>> freePipes;
+    // Счетчик изменений топологии сети (подключения, отключения, ремонт)
+    size_t topologyVersion = 0;
+    // Счетчик структурных изменений (состав ребер графа); ремонт его не меняет
+    size_t structureVersion = 0;
+    // Трубы, у которых менялся признак ремонта после последнего структурного изменения
+    PipeChangeLog repairLog;
+    // Счетчик изменений, добавляющих или меняющих ребра графа; удаление ребер его не меняет
+    size_t growthVersion = 0;
+    // Трубы, у которых менялась пропускная способность (ремонт, отключение, удаление)
+    // после последнего изменения growthVersion
+    PipeChangeLog capacityLog;
+    // Журналы держат не меньше записей, чем труб: догнать журнал не дороже перестройки
+    static constexpr size_t CHANGE_LOG_MIN = 4096;
+    // Колоночное зеркало для сканирования и построения графа (включается по требованию)
+    PipeColumns columns;
+    bool columnsEnabled = false;
+    // Вторичные индексы для поиска (включаются по требованию)
+    PipeIndexes indexes;
+    bool indexesEnabled = false;
+
 public:
     PipeManager(int& id, Logger& log) : GenericManager<Pipe>(id, log) {}
 
-    // Поиск свободной трубы по диаметру
-    int FindFreePipeID(int diameter) {
-        for (const auto& pipe : items) {
-            // Труба свободна, если она никуда не подключена (ids == 0) и подходит по диаметру
-            if (pipe.diametr == diameter && pipe.source_cs_id == 0 && pipe.dest_cs_id == 0) {
-                return pipe.id;
-            }
-        }
-        return -1; // Не найдено
+    // Поиск свободной трубы по диаметру (берется труба с наименьшим id)
+    int FindFreePipeID(int diameter) const {
+        auto it = freePipes.find(diameter);
+        if (it == freePipes.end() || it->second.empty()) return -1; // Не найдено
+        return *it->second.begin();
     }
 
     // Привязка трубы к станциям
     void LinkPipe(int pipeId, int sourceId, int destId) {
-        Pipe* p = FindById(pipeId);
-        if (p) {
-            p->source_cs_id = sourceId;
-            p->dest_cs_id = destId;
-        }
+        Edit(pipeId, [=](Pipe& p) {
+            p.source_cs_id = sourceId;
+            p.dest_cs_id = destId;
+        });
     }
     
     // Отвязка трубы (удаление из сети)
     void UnlinkPipe(int pipeId) {
-        Pipe* p = FindById(pipeId);
-        if (p) {
-            p->source_cs_id = 0;
-            p->dest_cs_id = 0;
-        }
+        LinkPipe(pipeId, 0, 0);
+    }
+
+    // Изменение признака "в ремонте"
+    bool SetRepair(int pipeId, bool repair) {
+        return Edit(pipeId, [=](Pipe& p) { p.repair = repair; });
+    }
+
+    // Включение колоночного хранилища; дальше оно поддерживается хуками вместе с items
+    void EnableColumns() {
+        if (columnsEnabled) return;
+        RebuildColumns();
+        columnsEnabled = true;
+    }
+
+    // nullptr, если колонки не включены
+    const PipeColumns* Columns() const { return columnsEnabled ? &columns : nullptr; }
+
+    // Включение индексов по диаметру, ремонту, длине и км отметке; дальше они поддерживаются хуками
+    void EnableIndexes() {
+        if (indexesEnabled) return;
+        indexes.Clear();
+        for (const auto& pipe : GetAll()) indexes.Insert(pipe);
+        indexesEnabled = true;
+    }
+
+    // nullptr, если индексы не включены
+    const PipeIndexes* Indexes() const { return indexesEnabled ? &indexes : nullptr; }
+
+    // Меняется при любом изменении, влияющем на граф сети
+    size_t GetTopologyVersion() const { return topologyVersion; }
+
+    // Потребители хранят позицию в журнале ремонтов и при неизменной структуре
+    // применяют только новые записи; при смене структуры журнал очищается,
+    // а позиция меньше Begin() тоже означает перестройку
+    size_t GetStructureVersion() const { return structureVersion; }
+    const PipeChangeLog& GetRepairLog() const { return repairLog; }
+
+    // Для потребителей со своей копией графа: удаленное ребро можно считать
+    // ребром с нулевой пропускной способностью, пока ребра не добавлялись
+    size_t GetGrowthVersion() const { return growthVersion; }
+    const PipeChangeLog& GetCapacityLog() const { return capacityLog; }
+
+    // Допустимые диаметры труб, мм
+    static bool IsAllowedDiameter(int diameter) {
+        return diameter == 500 || diameter == 700 || diameter == 1000 || diameter == 1400;
     }
 
 private:
+    // Труба свободна, если она никуда не подключена (ids == 0)
+    static bool IsFree(const Pipe& pipe) {
+        return pipe.source_cs_id == 0 && pipe.dest_cs_id == 0;
+    }
+
+    // Труба участвует в графе, только если подключена с обеих сторон
+    static bool IsLinked(const Pipe& pipe) {
+        return pipe.source_cs_id != 0 && pipe.dest_cs_id != 0;
+    }
+
+    void ReturnToPool(const Pipe& pipe) {
+        if (IsFree(pipe)) freePipes[pipe.diametr].insert(pipe.id);
+    }
+
+    void ReleaseFromPool(const Pipe& pipe) {
+        auto it = freePipes.find(pipe.diametr);
+        if (it != freePipes.end()) it->second.erase(pipe.id);
+    }
+
+    void StructureChanged() {
+        topologyVersion++;
+        structureVersion++;
+        repairLog.Clear();
+        growthVersion++;
+        capacityLog.Clear();
+    }
+
+    // Ребро трубы исчезло из графа: структура поменялась, но новых ребер нет
+    void EdgeRemoved(int pipeId) {
+        topologyVersion++;
+        structureVersion++;
+        repairLog.Clear();
+        capacityLog.Push(pipeId, ChangeLogLimit());
+    }
+
+    size_t ChangeLogLimit() const { return max(CHANGE_LOG_MIN, GetAll().size()); }
+
+    void OnInsert(const Pipe& pipe) override {
+        if (columnsEnabled) columns.Append(pipe);
+        if (indexesEnabled) indexes.Insert(pipe);
+        ReturnToPool(pipe);
+        if (IsLinked(pipe)) StructureChanged();
+    }
+
+    void OnErase(const Pipe& pipe) override {
+        if (columnsEnabled) columns.ClearRow((size_t)SlotOf(pipe.id));
+        if (indexesEnabled) indexes.Erase(pipe);
+        ReleaseFromPool(pipe);
+        if (IsLinked(pipe)) EdgeRemoved(pipe.id);
+    }
+
+    void OnEdit(const Pipe& before, const Pipe& after) override {
+        if (columnsEnabled) columns.Set((size_t)SlotOf(after.id), after);
+        if (indexesEnabled) indexes.Update(before, after);
+        ReleaseFromPool(before);
+        ReturnToPool(after);
+        if (IsLinked(before) && !IsLinked(after)) {
+            EdgeRemoved(after.id);
+        } else if (IsLinked(before) || IsLinked(after)) {
+            if (before.source_cs_id != after.source_cs_id || before.dest_cs_id != after.dest_cs_id ||
+                before.length != after.length || before.diametr != after.diametr) {
+                StructureChanged();
+            } else if (before.repair != after.repair) {
+                topologyVersion++;
+                repairLog.Push(after.id, ChangeLogLimit());
+                capacityLog.Push(after.id, ChangeLogLimit());
+            }
+        }
+    }
+
+    void OnReserve(size_t count) override {
+        if (columnsEnabled) columns.Reserve(count);
+    }
+
+    void OnCompact() override {
+        if (columnsEnabled) RebuildColumns();
+    }
+
+    // Строки колонок по всем слотам, включая пустые
+    void RebuildColumns() {
+        columns.Clear();
+        columns.Reserve(items.size());
+        for (size_t slot = 0; slot < items.size(); slot++) {
+            columns.Append(items[slot]);
+            if (!live.Test(slot)) columns.ClearRow(slot);
+        }
+    }
+
+    void OnClear() override {
+        columns.Clear();
+        indexes.Clear();
+        freePipes.clear();
+        StructureChanged();
+    }
+
     void OnAdd(const Pipe& pipe) override {
         stringstream ss;
         ss << "ADDED PIPE - ID: " << pipe.id << ", Diam: " << pipe.diametr;
         logger.Log(ss.str());
     }
 
+    void OnAddRange(int firstId, size_t count) override {
+        stringstream ss;
+        ss << "ADDED PIPES (BATCH) - IDs: " << firstId << "-" << firstId + (int)count - 1 << ", Count: " << count;
+        logger.Log(ss.str());
+    }
+
     void OnDelete(const Pipe& pipe) override {
         stringstream ss;
         ss << "DELETED PIPE - ID: " << pipe.id;
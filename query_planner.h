@@ -0,0 +1,354 @@
+#ifndef QUERY_PLANNER_H
+#define QUERY_PLANNER_H
+
+#include "structs.h"
+#include "pipe_manager.h"
+#include "compress_manager.h"
+#include "search_engine.h"
+#include "secondary_index.h"
+#include "logger.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+// Составной запрос: условия объединяются через &&, || и !.
+// Условие (лист) умеет три вещи: построить маску по менеджеру (через индексы и колонки
+// SearchEngine), проверить отдельную запись и оценить число совпадений.
+template<typename T, typename Manager>
+class Query {
+public:
+    using SelectFn = function<SelectionBitmap(SearchEngine&, const Manager&)>;
+    using MatchFn = function<bool(const T&)>;
+    using EstimateFn = function<size_t(const Manager&)>;
+
+    enum class Kind { Leaf, And, Or, Not };
+
+    static Query Leaf(const string& description, SelectFn select, MatchFn match, EstimateFn estimate) {
+        Query query(Kind::Leaf);
+        query.leaf = make_shared<const Condition>(Condition{description, move(select), move(match), move(estimate)});
+        return query;
+    }
+
+    Query operator&&(const Query& other) const { return Combine(Kind::And, other); }
+    Query operator||(const Query& other) const { return Combine(Kind::Or, other); }
+
+    Query operator!() const {
+        Query query(Kind::Not);
+        query.children.push_back(*this);
+        return query;
+    }
+
+    Kind GetKind() const { return kind; }
+    const vector<Query>& Children() const { return children; }
+
+    string Describe() const {
+        if (kind == Kind::Leaf) return leaf->description;
+        if (kind == Kind::Not) return "NOT " + children[0].Describe();
+        string result = "(";
+        for (size_t i = 0; i < children.size(); i++) {
+            if (i) result += kind == Kind::And ? " AND " : " OR ";
+            result += children[i].Describe();
+        }
+        return result + ")";
+    }
+
+    bool Matches(const T& item) const {
+        switch (kind) {
+            case Kind::Leaf: return leaf->match(item);
+            case Kind::Not: return !children[0].Matches(item);
+            case Kind::And:
+                for (const auto& child : children) if (!child.Matches(item)) return false;
+                return true;
+            case Kind::Or:
+                for (const auto& child : children) if (child.Matches(item)) return true;
+                return false;
+        }
+        return false;
+    }
+
+    // Оценка числа совпадений; без подходящего индекса - размер менеджера
+    size_t Estimate(const Manager& manager) const {
+        size_t total = manager.GetAll().size();
+        switch (kind) {
+            case Kind::Leaf: return min(total, leaf->estimate(manager));
+            case Kind::Not: return total - children[0].Estimate(manager);
+            case Kind::And: {
+                size_t best = total;
+                for (const auto& child : children) best = min(best, child.Estimate(manager));
+                return best;
+            }
+            case Kind::Or: {
+                size_t sum = 0;
+                for (const auto& child : children) sum += child.Estimate(manager);
+                return min(total, sum);
+            }
+        }
+        return total;
+    }
+
+    SelectionBitmap Select(SearchEngine& engine, const Manager& manager) const { return leaf->select(engine, manager); }
+
+private:
+    struct Condition {
+        string description;
+        SelectFn select;
+        MatchFn match;
+        EstimateFn estimate;
+    };
+
+    Kind kind;
+    vector<Query> children;
+    shared_ptr<const Condition> leaf;
+
+    explicit Query(Kind k) : kind(k) {}
+
+    // Одинаковые операции сливаются: (a && b) && c хранится как And(a, b, c)
+    Query Combine(Kind op, const Query& other) const {
+        Query query(op);
+        for (const Query* part : {this, &other}) {
+            if (part->kind == op) query.children.insert(query.children.end(), part->children.begin(), part->children.end());
+            else query.children.push_back(*part);
+        }
+        return query;
+    }
+};
+
+using PipeQuery = Query<Pipe, PipeManager>;
+using CompressQuery = Query<Compress, CompressManager>;
+
+// Потоковая выдача результата: записи отдаются по одной по маске слотов, без копий.
+// Действителен до удаления выбранных записей или уплотнения менеджера.
+template<typename T>
+class QueryCursor {
+private:
+    const GenericManager<T>* manager;
+    SelectionBitmap selection;
+    size_t word = 0;
+    uint64_t bits = 0;
+
+public:
+    QueryCursor(const GenericManager<T>& source, SelectionBitmap matched) : manager(&source), selection(move(matched)) {
+        if (!selection.words.empty()) bits = selection.words[0];
+    }
+
+    // nullptr, когда записи закончились
+    const T* Next() {
+        while (!bits) {
+            if (++word >= selection.words.size()) return nullptr;
+            bits = selection.words[word];
+        }
+        size_t slot = word * 64 + (size_t)__builtin_ctzll(bits);
+        bits &= bits - 1;
+        return &manager->AtSlot(slot);
+    }
+
+    size_t Count() const { return selection.Count(); }
+    const SelectionBitmap& Selection() const { return selection; }
+};
+
+// Исполнение составных запросов над масками позиций.
+// В AND условия идут по возрастанию оценки; когда совпадений остается мало,
+// остальные условия проверяются по отобранным записям вместо построения своих масок.
+class QueryPlanner {
+private:
+    SearchEngine& engine;
+    Logger& logger;
+
+    // Доля выборки, ниже которой дешевле проверять записи, чем строить маску условия
+    static constexpr size_t RecheckDivisor = 64;
+
+public:
+    QueryPlanner(SearchEngine& se, Logger& log) : engine(se), logger(log) {}
+
+    // Маска слотов менеджера (без пустых); журнал не пишется
+    template<typename T, typename Manager>
+    static SelectionBitmap Evaluate(SearchEngine& engine, const Query<T, Manager>& query, const Manager& manager) {
+        using Kind = typename Query<T, Manager>::Kind;
+        size_t slots = manager.SlotCount();
+        size_t total = manager.GetAll().size();
+        switch (query.GetKind()) {
+            case Kind::Leaf:
+                return query.Select(engine, manager);
+            case Kind::Not: {
+                SelectionBitmap result = Evaluate(engine, query.Children()[0], manager);
+                result.Invert();
+                result &= manager.LiveSlots();
+                return result;
+            }
+            case Kind::And: {
+                vector<pair<size_t, const Query<T, Manager>*>> order;
+                for (const auto& child : query.Children()) order.push_back({child.Estimate(manager), &child});
+                stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+                SelectionBitmap result = Evaluate(engine, *order[0].second, manager);
+                for (size_t k = 1; k < order.size(); k++) {
+                    size_t matched = result.Count();
+                    if (matched == 0) break;
+                    if (matched * RecheckDivisor < total) {
+                        SelectionBitmap kept(slots);
+                        result.ForEach([&](size_t i) {
+                            for (size_t rest = k; rest < order.size(); rest++) {
+                                if (!order[rest].second->Matches(manager.AtSlot(i))) return;
+                            }
+                            kept.Set(i);
+                        });
+                        return kept;
+                    }
+                    result &= Evaluate(engine, *order[k].second, manager);
+                }
+                return result;
+            }
+            case Kind::Or: {
+                SelectionBitmap result(slots);
+                for (const auto& child : query.Children()) {
+                    result |= Evaluate(engine, child, manager);
+                    if (result.Count() == total) break;
+                }
+                return result;
+            }
+        }
+        return SelectionBitmap(slots);
+    }
+
+    template<typename T, typename Manager>
+    QueryCursor<T> Run(const Query<T, Manager>& query, const Manager& manager, const string& what) {
+        QueryCursor<T> cursor(manager, Evaluate(engine, query, manager));
+        stringstream ss;
+        ss << "QUERY " << what << " - " << query.Describe() << " - Found: " << cursor.Count();
+        logger.Log(ss.str());
+        return cursor;
+    }
+
+    QueryCursor<Pipe> Run(const PipeQuery& query, const PipeManager& pipes) { return Run(query, pipes, "PIPES"); }
+    QueryCursor<Compress> Run(const CompressQuery& query, const CompressManager& stations) { return Run(query, stations, "CS"); }
+};
+
+// --- Условия для труб ---
+struct PipeWhere {
+    static PipeQuery Diameter(int diameter) {
+        return PipeQuery::Leaf("diameter = " + to_string(diameter),
+            [=](SearchEngine& se, const PipeManager& pipes) { return se.SelectPipesByDiameter(pipes, diameter); },
+            [=](const Pipe& p) { return p.diametr == diameter; },
+            [=](const PipeManager& pipes) {
+                const PipeIndexes* index = pipes.Indexes();
+                return index ? index->byDiameter.Count(diameter) : pipes.GetAll().size();
+            });
+    }
+
+    static PipeQuery Repair(bool repair) {
+        return PipeQuery::Leaf(repair ? "on repair" : "not on repair",
+            [=](SearchEngine& se, const PipeManager& pipes) { return se.SelectPipesByRepair(pipes, repair); },
+            [=](const Pipe& p) { return p.repair == repair; },
+            [=](const PipeManager& pipes) {
+                const PipeIndexes* index = pipes.Indexes();
+                return index ? index->byRepair.Count(repair) : pipes.GetAll().size();
+            });
+    }
+
+    static PipeQuery Length(double minLength, double maxLength) {
+        return PipeQuery::Leaf("length in [" + to_string(minLength) + ", " + to_string(maxLength) + "]",
+            [=](SearchEngine& se, const PipeManager& pipes) { return se.SelectPipesByLength(pipes, minLength, maxLength); },
+            [=](const Pipe& p) { return p.length >= minLength && p.length <= maxLength; },
+            [=](const PipeManager& pipes) {
+                const PipeIndexes* index = pipes.Indexes();
+                return index ? index->byLength.EstimateInRange(minLength, maxLength) : pipes.GetAll().size();
+            });
+    }
+
+    static PipeQuery KmMark(const string& kmMark) {
+        return PipeQuery::Leaf("km mark contains '" + kmMark + "'",
+            [=](SearchEngine& se, const PipeManager& pipes) { return se.SelectPipesByKmMark(pipes, kmMark); },
+            [=](const Pipe& p) { return p.km_mark.find(kmMark) != string::npos; },
+            [=](const PipeManager& pipes) {
+                const PipeIndexes* index = pipes.Indexes();
+                return index ? index->byKmMark.Estimate(kmMark) : pipes.GetAll().size();
+            });
+    }
+
+    // Трубы, у которых станция "откуда" или "куда" удовлетворяет запросу по станциям.
+    // Оценки нет, поэтому в AND это условие проверяется последним.
+    static PipeQuery LinkedTo(const CompressManager& stations, const CompressQuery& stationQuery) {
+        const CompressManager* source = &stations;
+        return PipeQuery::Leaf("linked to " + stationQuery.Describe(),
+            [=](SearchEngine& se, const PipeManager& pipes) {
+                IdBitmap matchedStations;
+                QueryPlanner::Evaluate(se, stationQuery, *source).ForEach([&](size_t i) {
+                    matchedStations.Set(source->AtSlot(i).id, true);
+                });
+                auto linked = [&](int from, int to) { return matchedStations.Test(from) || matchedStations.Test(to); };
+
+                SelectionBitmap result(pipes.SlotCount());
+                const PipeColumns* c = pipes.Columns();
+                pipes.LiveSlots().ForEach([&](size_t i) {
+                    bool match = c ? linked(c->source[i], c->dest[i])
+                                   : linked(pipes.AtSlot(i).source_cs_id, pipes.AtSlot(i).dest_cs_id);
+                    if (match) result.Set(i);
+                });
+                return result;
+            },
+            [=](const Pipe& p) {
+                for (int stationId : {p.source_cs_id, p.dest_cs_id}) {
+                    const Compress* station = stationId ? source->FindById(stationId) : nullptr;
+                    if (station && stationQuery.Matches(*station)) return true;
+                }
+                return false;
+            },
+            [](const PipeManager& pipes) { return pipes.GetAll().size(); });
+    }
+};
+
+// --- Условия для станций ---
+struct CompressWhere {
+    static CompressQuery Name(const string& name) {
+        return CompressQuery::Leaf("name contains '" + name + "'",
+            [=](SearchEngine& se, const CompressManager& stations) { return se.SelectCompressByName(stations, name); },
+            [=](const Compress& c) { return c.name.find(name) != string::npos; },
+            [=](const CompressManager& stations) {
+                const CompressIndexes* index = stations.Indexes();
+                return index ? index->byName.Estimate(name) : stations.GetAll().size();
+            });
+    }
+
+    static CompressQuery Classification(const string& classification) {
+        return CompressQuery::Leaf("class contains '" + classification + "'",
+            [=](SearchEngine& se, const CompressManager& stations) { return se.SelectCompressByClassification(stations, classification); },
+            [=](const Compress& c) { return c.classification.find(classification) != string::npos; },
+            [=](const CompressManager& stations) {
+                const CompressIndexes* index = stations.Indexes();
+                return index ? index->byClassification.Estimate(classification) : stations.GetAll().size();
+            });
+    }
+
+    static CompressQuery Working(bool working) {
+        return CompressQuery::Leaf(working ? "working" : "not working",
+            [=](SearchEngine& se, const CompressManager& stations) { return se.SelectCompressByStatus(stations, working); },
+            [=](const Compress& c) { return c.working == working; },
+            [=](const CompressManager& stations) {
+                const CompressIndexes* index = stations.Indexes();
+                if (!index) return stations.GetAll().size();
+                return working ? index->working.Count() : stations.GetAll().size() - index->working.Count();
+            });
+    }
+
+    static CompressQuery WorkshopPercentage(double minPercent, double maxPercent) {
+        return CompressQuery::Leaf("workshops in [" + to_string(minPercent) + "%, " + to_string(maxPercent) + "%]",
+            [=](SearchEngine& se, const CompressManager& stations) {
+                return se.SelectCompressByWorkshopPercentage(stations, minPercent, maxPercent);
+            },
+            [=](const Compress& c) {
+                double percentage;
+                return CompressIndexes::WorkshopPercentage(c, percentage) && percentage >= minPercent && percentage <= maxPercent;
+            },
+            [=](const CompressManager& stations) {
+                const CompressIndexes* index = stations.Indexes();
+                return index ? index->byWorkshopPercentage.EstimateInRange(minPercent, maxPercent) : stations.GetAll().size();
+            });
+    }
+};
+
+#endif
@@ -0,0 +1,461 @@
+#ifndef RPC_SERVER_H
+#define RPC_SERVER_H
+
+#include "batch_runner.h"
+#include "network_versions.h"
+#include "logger.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Сервер запросов на Unix-сокете или localhost TCP.
+//
+// Протокол: кадр = [uint32 little-endian длина][данные]. Данные запроса - команда в синтаксисе
+// пакетного режима (см. BatchRunner), данные ответа - JSON-объект, как в batch --json;
+// поле "line" - номер запроса в соединении. Клиент может отправлять запросы подряд, не дожидаясь
+// ответов: ответы приходят в том же порядке.
+//
+// Один поток epoll читает и пишет сокеты, запросы выполняет пул рабочих. Запросы одного
+// соединения выполняются по очереди (чтение после записи видит запись), разные соединения -
+// параллельно. path и maxflow идут по опубликованной версии сети без блокировок, остальные
+// команды - через VersionedNetwork::Write, по одной.
+//
+// Сокеты всегда неблокирующие: рабочий только пробует отправить ответ, остаток дописывает
+// поток epoll по EPOLLOUT. Если у соединения скопилось слишком много запросов или неотправленных
+// ответов, сервер перестает читать его сокет (и не берет его запросы, пока не уйдут ответы),
+// поэтому клиент, который не читает ответы, не занимает ни рабочих, ни память.
+class RpcServer {
+public:
+    struct Options {
+        string unixPath;        // непустой - Unix-сокет, иначе TCP
+        int tcpPort = 0;
+        int workers = 0;        // 0 - по числу ядер
+    };
+
+private:
+    static constexpr uint32_t MAX_FRAME = 1 << 20;
+    static constexpr size_t READ_CHUNK = 64 * 1024;
+    static constexpr size_t READ_PER_EVENT = 16 * READ_CHUNK;   // не больше за одно событие
+    static constexpr size_t BATCH_PER_TURN = 64;      // запросов соединения за один заход рабочего
+    // Пределы очереди соединения: выше них чтение сокета приостанавливается
+    static constexpr size_t MAX_QUEUED = 1024;
+    static constexpr size_t MAX_OUT_BYTES = 4 << 20;
+
+    struct Connection {
+        int fd;
+        size_t nextSeq = 0;
+        string in;                 // только поток epoll
+
+        mutex lock;                // защищает поля ниже
+        deque<pair<size_t, string>> requests;
+        string out;
+        bool scheduled = false;    // соединение в очереди или у рабочего
+        bool closed = false;
+        bool eof = false;          // клиент закрыл передачу; ответы еще досылаются
+        uint32_t events = 0;       // текущая подписка epoll
+
+        explicit Connection(int socket) : fd(socket) {}
+        ~Connection() { ::close(fd); }
+    };
+
+    Options options;
+    Logger& logger;
+    BatchRunner& runner;
+    VersionedNetwork& versions;
+
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    atomic<bool> stopping{false};
+    unordered_map<int, shared_ptr<Connection>> connections;   // только поток epoll
+
+    mutex queueLock;
+    condition_variable queueReady;
+    deque<shared_ptr<Connection>> readyQueue;
+    vector<thread> pool;
+
+    atomic<size_t> served{0};
+    string error;
+
+public:
+    RpcServer(const Options& opts, Logger& log, BatchRunner& batch, VersionedNetwork& network)
+        : options(opts), logger(log), runner(batch), versions(network) {}
+
+    RpcServer(const RpcServer&) = delete;
+    RpcServer& operator=(const RpcServer&) = delete;
+
+    ~RpcServer() {
+        StopWorkers();
+        connections.clear();
+        if (listenFd != -1) ::close(listenFd);
+        if (epollFd != -1) ::close(epollFd);
+        if (wakeFd != -1) ::close(wakeFd);
+        if (!options.unixPath.empty()) ::unlink(options.unixPath.c_str());
+    }
+
+    const string& Error() const { return error; }
+    size_t Served() const { return served.load(); }
+
+    bool Start() {
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (wakeFd == -1 || epollFd == -1) return Fail("epoll");
+        if (!Listen()) return false;
+        Watch(listenFd, EPOLLIN);
+        Watch(wakeFd, EPOLLIN);
+
+        int workers = options.workers > 0 ? options.workers : (int)max(1u, thread::hardware_concurrency());
+        for (int i = 0; i < workers; i++) pool.emplace_back([this]() { WorkerLoop(); });
+        logger.Log("RPC SERVER STARTED - " + Endpoint() + ", workers: " + to_string(workers));
+        return true;
+    }
+
+    // Цикл epoll до Stop()
+    void Serve() {
+        epoll_event events[64];
+        while (!stopping.load()) {
+            int count = epoll_wait(epollFd, events, 64, -1);
+            if (count == -1) {
+                if (errno == EINTR) continue;
+                Fail("epoll_wait");
+                break;
+            }
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) Accept();
+                else if (fd == wakeFd) DrainWake();
+                else OnSocket(fd, events[i].events);
+            }
+        }
+        StopWorkers();
+        logger.Log("RPC SERVER STOPPED - Requests: " + to_string(served.load()));
+    }
+
+    // Можно вызывать из другого потока и из обработчика сигнала
+    void Stop() {
+        stopping.store(true);
+        uint64_t one = 1;
+        if (::write(wakeFd, &one, sizeof(one)) < 0) {}
+    }
+
+    string Endpoint() const {
+        return options.unixPath.empty() ? "tcp 127.0.0.1:" + to_string(options.tcpPort) : "unix " + options.unixPath;
+    }
+
+    // Кодирование кадра (для клиентов)
+    static string Frame(const string& payload) {
+        uint32_t size = (uint32_t)payload.size();
+        string frame(4, '\0');
+        for (int i = 0; i < 4; i++) frame[i] = (char)((size >> (8 * i)) & 0xFF);
+        return frame + payload;
+    }
+
+private:
+    bool Fail(const string& what) {
+        error = what + ": " + strerror(errno);
+        return false;
+    }
+
+    void Watch(int fd, uint32_t events, int op = EPOLL_CTL_ADD) {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, op, fd, &event);
+    }
+
+    bool Listen() {
+        if (!options.unixPath.empty()) {
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd == -1) return Fail("socket");
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            if (options.unixPath.size() >= sizeof(address.sun_path)) {
+                error = "socket path too long";
+                return false;
+            }
+            strcpy(address.sun_path, options.unixPath.c_str());
+            ::unlink(options.unixPath.c_str());
+            if (bind(listenFd, (sockaddr*)&address, sizeof(address)) == -1) return Fail("bind " + options.unixPath);
+        } else {
+            listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd == -1) return Fail("socket");
+            int yes = 1;
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = htons((uint16_t)options.tcpPort);
+            if (bind(listenFd, (sockaddr*)&address, sizeof(address)) == -1) return Fail("bind port " + to_string(options.tcpPort));
+            socklen_t length = sizeof(address);
+            getsockname(listenFd, (sockaddr*)&address, &length);
+            options.tcpPort = ntohs(address.sin_port);   // для порта 0 - выбранный системой
+        }
+        if (listen(listenFd, SOMAXCONN) == -1) return Fail("listen");
+        return true;
+    }
+
+    void Accept() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1) return;
+            if (options.unixPath.empty()) {
+                int yes = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            }
+            auto conn = make_shared<Connection>(fd);
+            conn->events = EPOLLIN | EPOLLRDHUP;
+            connections[fd] = conn;
+            Watch(fd, conn->events);
+        }
+    }
+
+    void DrainWake() {
+        uint64_t value;
+        while (::read(wakeFd, &value, sizeof(value)) > 0) {}
+    }
+
+    void OnSocket(int fd, uint32_t events) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        shared_ptr<Connection> conn = it->second;
+
+        if (events & EPOLLOUT) {
+            unique_lock<mutex> guard(conn->lock);
+            if (!Flush(*conn) || Drained(*conn)) {
+                guard.unlock();
+                return Close(conn);
+            }
+            Resume(conn);
+            Rearm(*conn);
+        }
+        bool eof;
+        {
+            lock_guard<mutex> guard(conn->lock);
+            eof = conn->eof;
+        }
+        if (eof) {
+            // Клиент уже не пишет; HUP/ERR - не может и читать
+            if (events & (EPOLLHUP | EPOLLERR)) Close(conn);
+            return;
+        }
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            char buffer[READ_CHUNK];
+            size_t total = 0;
+            while (total < READ_PER_EVENT) {
+                ssize_t got = ::read(fd, buffer, sizeof(buffer));
+                if (got > 0) {
+                    conn->in.append(buffer, (size_t)got);
+                    total += (size_t)got;
+                    continue;
+                }
+                if (got == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                if (got == -1 && errno == EINTR) continue;
+                if (got == 0 && ExtractFrames(conn)) return Finish(conn);
+                return Close(conn);
+            }
+            if (!ExtractFrames(conn)) return Close(conn);
+        }
+    }
+
+    // Полные кадры из входного буфера - в очередь соединения
+    bool ExtractFrames(const shared_ptr<Connection>& conn) {
+        size_t pos = 0;
+        {
+            lock_guard<mutex> guard(conn->lock);
+            while (conn->in.size() - pos >= 4) {
+                const unsigned char* head = (const unsigned char*)conn->in.data() + pos;
+                uint32_t size = (uint32_t)head[0] | (uint32_t)head[1] << 8 | (uint32_t)head[2] << 16 | (uint32_t)head[3] << 24;
+                if (size > MAX_FRAME) return false;
+                if (conn->in.size() - pos - 4 < size) break;
+                conn->requests.push_back({++conn->nextSeq, conn->in.substr(pos + 4, size)});
+                pos += 4 + size;
+            }
+            Resume(conn);
+            Rearm(*conn);
+        }
+        conn->in.erase(0, pos);
+        return true;
+    }
+
+    void Close(const shared_ptr<Connection>& conn) {
+        {
+            lock_guard<mutex> guard(conn->lock);
+            conn->closed = true;
+            conn->requests.clear();
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+        connections.erase(conn->fd);   // сокет закроется, когда рабочие отпустят соединение
+    }
+
+    // Клиент закончил передачу (shutdown на запись): принятые запросы выполняются,
+    // ответы досылаются по EPOLLOUT, после последнего соединение закрывается
+    void Finish(const shared_ptr<Connection>& conn) {
+        unique_lock<mutex> guard(conn->lock);
+        conn->eof = true;
+        if (Drained(*conn)) {
+            guard.unlock();
+            return Close(conn);
+        }
+        Rearm(*conn);
+    }
+
+    // Дальше вызываются под conn.lock
+
+    // Клиент закрыл передачу, и все ответы ему отправлены
+    static bool Drained(const Connection& conn) {
+        return conn.eof && !conn.scheduled && conn.requests.empty() && conn.out.empty();
+    }
+
+    static bool Overloaded(const Connection& conn) {
+        return conn.requests.size() >= MAX_QUEUED || conn.out.size() >= MAX_OUT_BYTES;
+    }
+
+    // Подписка по состоянию: чтение - пока очередь не переполнена, запись - пока есть что
+    // отправить. После eof EPOLLOUT ставится и для закрытия: его разбирает поток epoll.
+    void Rearm(Connection& conn) {
+        if (conn.closed) return;
+        uint32_t events = 0;
+        if (!conn.eof && !Overloaded(conn)) events |= EPOLLIN | EPOLLRDHUP;
+        if (!conn.out.empty() || Drained(conn)) events |= EPOLLOUT;
+        if (events == conn.events) return;
+        conn.events = events;
+        Watch(conn.fd, events, EPOLL_CTL_MOD);
+    }
+
+    // Передача соединения рабочим, если есть запросы и ответы не копятся
+    void Resume(const shared_ptr<Connection>& conn) {
+        if (conn->scheduled || conn->closed || conn->requests.empty() || conn->out.size() >= MAX_OUT_BYTES) return;
+        conn->scheduled = true;
+        Schedule(conn);
+    }
+
+    // Неблокирующая отправка накопленного; false при ошибке сокета
+    bool Flush(Connection& conn) {
+        size_t sent = 0;
+        while (sent < conn.out.size()) {
+            ssize_t wrote = ::send(conn.fd, conn.out.data() + sent, conn.out.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (wrote > 0) {
+                sent += (size_t)wrote;
+                continue;
+            }
+            if (wrote == -1 && errno == EINTR) continue;
+            if (wrote == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        conn.out.erase(0, sent);
+        return true;
+    }
+
+    void Schedule(shared_ptr<Connection> conn) {
+        {
+            lock_guard<mutex> guard(queueLock);
+            readyQueue.push_back(move(conn));
+        }
+        queueReady.notify_one();
+    }
+
+    void StopWorkers() {
+        stopping.store(true);
+        queueReady.notify_all();
+        for (auto& worker : pool) worker.join();
+        pool.clear();
+    }
+
+    void WorkerLoop() {
+        NetworkReader reader(versions);
+        while (true) {
+            shared_ptr<Connection> conn;
+            {
+                unique_lock<mutex> guard(queueLock);
+                queueReady.wait(guard, [this]() { return stopping.load() || !readyQueue.empty(); });
+                if (stopping.load()) return;
+                conn = move(readyQueue.front());
+                readyQueue.pop_front();
+            }
+
+            for (size_t turn = 0;; turn++) {
+                pair<size_t, string> request;
+                {
+                    lock_guard<mutex> guard(conn->lock);
+                    // Клиент не забирает ответы: соединение вернется в очередь после EPOLLOUT
+                    if (conn->closed || conn->requests.empty() || conn->out.size() >= MAX_OUT_BYTES) {
+                        conn->scheduled = false;
+                        Rearm(*conn);
+                        break;
+                    }
+                    if (turn == BATCH_PER_TURN) {   // уступаем другим соединениям
+                        Schedule(conn);
+                        break;
+                    }
+                    request = move(conn->requests.front());
+                    conn->requests.pop_front();
+                }
+                string response = Handle(reader, request.first, request.second);
+                served++;
+                lock_guard<mutex> guard(conn->lock);
+                if (conn->closed) continue;
+                // Пока ждем EPOLLOUT, отправляет поток epoll; ошибку сокета он же и обработает
+                bool waiting = !conn->out.empty();
+                conn->out += Frame(response);
+                if (!waiting) Flush(*conn);
+                Rearm(*conn);
+            }
+        }
+    }
+
+    string Handle(NetworkReader& reader, size_t seq, const string& text) {
+        ostringstream out;
+        BatchReply reply;
+        vector<string> tokens;
+        string parseError, output;
+        auto started = chrono::steady_clock::now();
+        string command = "?";
+
+        if (!BatchRunner::Tokenize(text, tokens, parseError)) reply.Fail(parseError);
+        else if (tokens.empty()) reply.Fail("empty request");
+        else {
+            command = tokens[0];
+            tokens.erase(tokens.begin());
+            BatchArgs args(move(tokens));
+            if (command == "path" || command == "maxflow") {
+                reader.Pin();
+                if (command == "path") BatchRunner::ShortestPath(reader, args, reply);
+                else BatchRunner::MaxFlow(reader, args, reply);
+                if (!args.Error().empty()) reply.Fail(args.Error());
+                reply.Add("version", (size_t)reader.Version().epoch);
+            } else if (command == "quit" || command == "exit") {
+                reply.Fail("not available over RPC");
+            } else {
+                versions.Write([&](PipeManager&, CompressManager&) { runner.Execute(command, move(args), reply, output); });
+            }
+        }
+
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+        reply.WriteJson(out, command, seq, micros, output);
+        string response = out.str();
+        if (!response.empty() && response.back() == '\n') response.pop_back();
+        return response;
+    }
+};
+
+#endif
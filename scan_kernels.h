@@ -0,0 +1,208 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_KERNELS_X86 1
+#endif
+
+using namespace std;
+
+// Результат фильтра по колонкам: бит i установлен, если строка i подходит.
+// Биты за пределами size всегда нулевые.
+struct SelectionBitmap {
+    vector<uint64_t> words;
+    size_t size = 0;
+
+    SelectionBitmap() = default;
+    explicit SelectionBitmap(size_t n, bool value = false) { Reset(n, value); }
+
+    void Reset(size_t n, bool value = false) {
+        size = n;
+        words.assign((n + 63) / 64, value ? ~uint64_t(0) : 0);
+        TrimTail();
+    }
+
+    bool Test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void Set(size_t i) { words[i >> 6] |= uint64_t(1) << (i & 63); }
+    void Unset(size_t i) { words[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+    void PushBack(bool value) {
+        if ((size & 63) == 0) words.push_back(0);
+        if (value) Set(size);
+        size++;
+    }
+
+    size_t Count() const {
+        size_t total = 0;
+        for (uint64_t w : words) total += (size_t)__builtin_popcountll(w);
+        return total;
+    }
+
+    SelectionBitmap& operator&=(const SelectionBitmap& other) {
+        for (size_t k = 0; k < words.size(); k++) words[k] &= other.words[k];
+        return *this;
+    }
+
+    SelectionBitmap& operator|=(const SelectionBitmap& other) {
+        for (size_t k = 0; k < words.size(); k++) words[k] |= other.words[k];
+        return *this;
+    }
+
+    void Invert() {
+        for (uint64_t& w : words) w = ~w;
+        TrimTail();
+    }
+
+    // Обход установленных битов по возрастанию
+    template<typename Visitor>
+    void ForEach(Visitor visit) const {
+        for (size_t k = 0; k < words.size(); k++) {
+            uint64_t w = words[k];
+            while (w) {
+                visit(k * 64 + (size_t)__builtin_ctzll(w));
+                w &= w - 1;
+            }
+        }
+    }
+
+    vector<size_t> Slots() const {
+        vector<size_t> slots;
+        slots.reserve(Count());
+        ForEach([&slots](size_t i) { slots.push_back(i); });
+        return slots;
+    }
+
+private:
+    void TrimTail() {
+        if (size & 63) words.back() &= (uint64_t(1) << (size & 63)) - 1;
+    }
+};
+
+// Векторные ядра фильтров. AVX2 выбирается при запуске по возможностям процессора,
+// иначе работает скалярная версия с тем же результатом.
+namespace ScanKernels {
+
+inline bool HasAvx2() {
+#ifdef SCAN_KERNELS_X86
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// --- Скалярные версии ---
+inline void EqualIntScalar(const int* data, size_t from, size_t n, int value, uint64_t* words) {
+    for (size_t i = from; i < n; i++) {
+        if (data[i] == value) words[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+}
+
+inline void RangeDoubleScalar(const double* data, size_t from, size_t n, double lo, double hi, uint64_t* words) {
+    for (size_t i = from; i < n; i++) {
+        if (data[i] >= lo && data[i] <= hi) words[i >> 6] |= uint64_t(1) << (i & 63);
+    }
+}
+
+// Доля num/den в процентах в [lo, hi]; строки с den <= 0 не подходят
+inline void PercentRangeScalar(const int* num, const int* den, size_t from, size_t n, double lo, double hi, uint64_t* words) {
+    for (size_t i = from; i < n; i++) {
+        if (den[i] > 0) {
+            double percentage = (double)num[i] / den[i] * 100;
+            if (percentage >= lo && percentage <= hi) words[i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+}
+
+#ifdef SCAN_KERNELS_X86
+// --- AVX2: по 8 строк за шаг, маска сравнения сразу превращается в 8 бит результата ---
+__attribute__((target("avx2")))
+inline size_t EqualIntAvx2(const int* data, size_t n, int value, uint64_t* words) {
+    __m256i v = _mm256_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(data + i));
+        uint64_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, v)));
+        words[i >> 6] |= bits << (i & 63);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t RangeDoubleAvx2(const double* data, size_t n, double lo, double hi, uint64_t* words) {
+    __m256d vlo = _mm256_set1_pd(lo);
+    __m256d vhi = _mm256_set1_pd(hi);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_loadu_pd(data + i);
+        __m256d b = _mm256_loadu_pd(data + i + 4);
+        __m256d ma = _mm256_and_pd(_mm256_cmp_pd(a, vlo, _CMP_GE_OQ), _mm256_cmp_pd(a, vhi, _CMP_LE_OQ));
+        __m256d mb = _mm256_and_pd(_mm256_cmp_pd(b, vlo, _CMP_GE_OQ), _mm256_cmp_pd(b, vhi, _CMP_LE_OQ));
+        uint64_t bits = (uint32_t)(_mm256_movemask_pd(ma) | (_mm256_movemask_pd(mb) << 4));
+        words[i >> 6] |= bits << (i & 63);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t PercentRangeAvx2(const int* num, const int* den, size_t n, double lo, double hi, uint64_t* words) {
+    __m256d vlo = _mm256_set1_pd(lo);
+    __m256d vhi = _mm256_set1_pd(hi);
+    __m256d hundred = _mm256_set1_pd(100.0);
+    __m256d zero = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t bits = 0;
+        for (int half = 0; half < 2; half++) {
+            __m256d a = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(num + i + half * 4)));
+            __m256d b = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(den + i + half * 4)));
+            __m256d p = _mm256_mul_pd(_mm256_div_pd(a, b), hundred);
+            __m256d m = _mm256_and_pd(_mm256_cmp_pd(b, zero, _CMP_GT_OQ),
+                        _mm256_and_pd(_mm256_cmp_pd(p, vlo, _CMP_GE_OQ), _mm256_cmp_pd(p, vhi, _CMP_LE_OQ)));
+            bits |= (uint64_t)_mm256_movemask_pd(m) << (half * 4);
+        }
+        words[i >> 6] |= bits << (i & 63);
+    }
+    return i;
+}
+#endif
+
+// --- Точки входа ---
+inline SelectionBitmap SelectEqual(const vector<int>& column, int value) {
+    SelectionBitmap result(column.size());
+    size_t done = 0;
+#ifdef SCAN_KERNELS_X86
+    if (HasAvx2()) done = EqualIntAvx2(column.data(), column.size(), value, result.words.data());
+#endif
+    EqualIntScalar(column.data(), done, column.size(), value, result.words.data());
+    return result;
+}
+
+inline SelectionBitmap SelectRange(const vector<double>& column, double lo, double hi) {
+    SelectionBitmap result(column.size());
+    size_t done = 0;
+#ifdef SCAN_KERNELS_X86
+    if (HasAvx2()) done = RangeDoubleAvx2(column.data(), column.size(), lo, hi, result.words.data());
+#endif
+    RangeDoubleScalar(column.data(), done, column.size(), lo, hi, result.words.data());
+    return result;
+}
+
+inline SelectionBitmap SelectPercentRange(const vector<int>& num, const vector<int>& den, double lo, double hi) {
+    SelectionBitmap result(num.size());
+    size_t done = 0;
+#ifdef SCAN_KERNELS_X86
+    if (HasAvx2()) done = PercentRangeAvx2(num.data(), den.data(), num.size(), lo, hi, result.words.data());
+#endif
+    PercentRangeScalar(num.data(), den.data(), done, num.size(), lo, hi, result.words.data());
+    return result;
+}
+
+} // namespace ScanKernels
+
+#endif
@@ -2,11 +2,17 @@
 #define SEARCH_ENGINE_H
 
 #include "structs.h"
+#include "pipe_manager.h"
+#include "compress_manager.h"
+#include "scan_kernels.h"
 #include "logger.h"
+#include "task_scheduler.h"
 #include <vector>
 #include <sstream>
 #include <iomanip>
 #include <functional>
+#include <algorithm>
+#include <string_view>
 
 using namespace std;
 
@@ -20,7 +26,7 @@ public:
 
     virtual ~GenericSearchEngine() = default;
 
-    vector<T> SearchById(const vector<T>& items, int id) {
+    vector<T> SearchById(ItemRange<T> items, int id) {
         vector<T> results;
         for (const auto& item : items) {
             if (item.id == id) {
@@ -32,7 +38,7 @@ public:
         return results;
     }
 
-    vector<T> SearchByCondition(const vector<T>& items, function<bool(const T&)> condition, const string& description) {
+    vector<T> SearchByCondition(ItemRange<T> items, function<bool(const T&)> condition, const string& description) {
         vector<T> results;
         for (const auto& item : items) {
             if (condition(item)) {
@@ -50,57 +56,205 @@ class SearchEngine : public GenericSearchEngine<Pipe>, public GenericSearchEngin
 public:
     SearchEngine(Logger& log) : GenericSearchEngine<Pipe>(log), GenericSearchEngine<Compress>(log) {}
 
-    vector<Pipe> SearchPipesById(const vector<Pipe>& pipes, int id) {
+    vector<Pipe> SearchPipesById(ItemRange<Pipe> pipes, int id) {
         return GenericSearchEngine<Pipe>::SearchById(pipes, id);
     }
 
-    vector<Pipe> SearchPipesByKmMark(const vector<Pipe>& pipes, const string& kmMark) {
+    vector<Pipe> SearchPipesByKmMark(ItemRange<Pipe> pipes, const string& kmMark) {
         return GenericSearchEngine<Pipe>::SearchByCondition(pipes,
             [&kmMark](const Pipe& p) { return p.km_mark.find(kmMark) != string::npos; },
             "SEARCH PIPE BY KM MARK - Query: '" + kmMark + "'");
     }
 
-    vector<Pipe> SearchPipesByDiameter(const vector<Pipe>& pipes, int diameter) {
+    vector<Pipe> SearchPipesByDiameter(ItemRange<Pipe> pipes, int diameter) {
         return GenericSearchEngine<Pipe>::SearchByCondition(pipes,
             [diameter](const Pipe& p) { return p.diametr == diameter; },
             "SEARCH PIPE BY DIAMETER - Diameter: " + to_string(diameter) + " mm");
     }
 
-    vector<Pipe> SearchPipesByRepair(const vector<Pipe>& pipes, bool repair) {
+    vector<Pipe> SearchPipesByRepair(ItemRange<Pipe> pipes, bool repair) {
         return GenericSearchEngine<Pipe>::SearchByCondition(pipes,
             [repair](const Pipe& p) { return p.repair == repair; },
             "SEARCH PIPE BY REPAIR STATUS - Status: " + string(repair ? "On repair" : "Not on repair"));
     }
 
-    vector<Pipe> SearchPipesByLength(const vector<Pipe>& pipes, double minLength, double maxLength) {
+    vector<Pipe> SearchPipesByLength(ItemRange<Pipe> pipes, double minLength, double maxLength) {
         return GenericSearchEngine<Pipe>::SearchByCondition(pipes,
             [minLength, maxLength](const Pipe& p) { return p.length >= minLength && p.length <= maxLength; },
             "SEARCH PIPE BY LENGTH - Range: " + to_string(minLength) + "-" + to_string(maxLength) + " km");
     }
 
-    vector<Compress> SearchCompressById(const vector<Compress>& stations, int id) {
+    // --- Выборка по менеджеру ---
+    // Результат - битовая маска слотов менеджера (SlotOf), без копирования записей;
+    // пустые слоты удаленных записей в нее не попадают.
+    // Источник выбирается по оценке выборки: вторичный индекс, если подходит малая доля
+    // записей (см. IndexIsSelective), иначе колонки (векторные ядра), и только без них -
+    // проход по объектам.
+    SelectionBitmap SelectPipesByDiameter(const PipeManager& pipes, int diameter) {
+        const PipeIndexes* index = pipes.Indexes();
+        const PipeColumns* c = pipes.Columns();
+        if (index && (!c || IndexIsSelective(index->byDiameter.Count(diameter), pipes))) {
+            return SelectIdSet(pipes, index->byDiameter.Find(diameter));
+        }
+        if (c) return LiveOnly(pipes, ScanKernels::SelectEqual(c->diametr, diameter));
+        return SelectWhere(pipes, [diameter](const Pipe& p) { return p.diametr == diameter; });
+    }
+
+    // Битовая колонка ремонта дешевле списка id, поэтому здесь она в приоритете
+    SelectionBitmap SelectPipesByRepair(const PipeManager& pipes, bool repair) {
+        if (const PipeColumns* c = pipes.Columns()) {
+            SelectionBitmap result(c->Size());
+            result.words = c->repairBits;
+            if (!repair) result.Invert();
+            return LiveOnly(pipes, move(result));
+        }
+        if (const PipeIndexes* index = pipes.Indexes()) return SelectIdSet(pipes, index->byRepair.Find(repair));
+        return SelectWhere(pipes, [repair](const Pipe& p) { return p.repair == repair; });
+    }
+
+    SelectionBitmap SelectPipesByLength(const PipeManager& pipes, double minLength, double maxLength) {
+        const PipeIndexes* index = pipes.Indexes();
+        const PipeColumns* c = pipes.Columns();
+        if (index && (!c || IndexIsSelective(index->byLength.EstimateInRange(minLength, maxLength), pipes))) {
+            return SelectIds(pipes, [&](auto visit) { index->byLength.ForEachInRange(minLength, maxLength, visit); });
+        }
+        if (c) return LiveOnly(pipes, ScanKernels::SelectRange(c->length, minLength, maxLength));
+        return SelectWhere(pipes, [minLength, maxLength](const Pipe& p) { return p.length >= minLength && p.length <= maxLength; });
+    }
+
+    SelectionBitmap SelectCompressByWorkshopPercentage(const CompressManager& stations, double minPercent, double maxPercent) {
+        const CompressIndexes* index = stations.Indexes();
+        const CompressColumns* c = stations.Columns();
+        if (index && (!c || IndexIsSelective(index->byWorkshopPercentage.EstimateInRange(minPercent, maxPercent), stations))) {
+            return SelectIds(stations, [&](auto visit) { index->byWorkshopPercentage.ForEachInRange(minPercent, maxPercent, visit); });
+        }
+        if (c) return LiveOnly(stations, ScanKernels::SelectPercentRange(c->workshopWorking, c->workshopCount, minPercent, maxPercent));
+        return SelectWhere(stations, [minPercent, maxPercent](const Compress& c) {
+            double percentage;
+            return CompressIndexes::WorkshopPercentage(c, percentage) && percentage >= minPercent && percentage <= maxPercent;
+        });
+    }
+
+    SelectionBitmap SelectCompressByStatus(const CompressManager& stations, bool working) {
+        if (const CompressIndexes* index = stations.Indexes()) {
+            SelectionBitmap result = SelectIds(stations, [&](auto visit) { index->working.ForEach(visit); });
+            if (!working) result.Invert();
+            return LiveOnly(stations, move(result));
+        }
+        if (const CompressColumns* c = stations.Columns()) {
+            SelectionBitmap result(c->Size());
+            result.words = c->workingBits;
+            if (!working) result.Invert();
+            return LiveOnly(stations, move(result));
+        }
+        return SelectWhere(stations, [working](const Compress& c) { return c.working == working; });
+    }
+
+    // Подстрочные условия без ранжирования - для составных запросов
+    SelectionBitmap SelectPipesByKmMark(const PipeManager& pipes, const string& kmMark) {
+        const PipeIndexes* index = pipes.Indexes();
+        return SelectText(pipes, index ? &index->byKmMark : nullptr, kmMark, [](const Pipe& p) { return string_view(p.km_mark); });
+    }
+
+    SelectionBitmap SelectCompressByName(const CompressManager& stations, const string& name) {
+        const CompressIndexes* index = stations.Indexes();
+        return SelectText(stations, index ? &index->byName : nullptr, name, [](const Compress& c) { return string_view(c.name); });
+    }
+
+    SelectionBitmap SelectCompressByClassification(const CompressManager& stations, const string& classification) {
+        const CompressIndexes* index = stations.Indexes();
+        return SelectText(stations, index ? &index->byClassification : nullptr, classification,
+            [](const Compress& c) { return string_view(c.classification); });
+    }
+
+    // ID выбранных записей
+    template<typename T>
+    static vector<int> IdsOf(const SelectionBitmap& selection, const GenericManager<T>& manager) {
+        vector<int> ids;
+        ids.reserve(selection.Count());
+        selection.ForEach([&](size_t slot) { ids.push_back(manager.AtSlot(slot).id); });
+        return ids;
+    }
+
+    // --- Поиск с копированием найденного (совместимость) ---
+    vector<Pipe> SearchPipesByDiameter(const PipeManager& pipes, int diameter) {
+        return Collect(pipes, SelectPipesByDiameter(pipes, diameter),
+            "SEARCH PIPE BY DIAMETER - Diameter: " + to_string(diameter) + " mm");
+    }
+
+    vector<Pipe> SearchPipesByRepair(const PipeManager& pipes, bool repair) {
+        return Collect(pipes, SelectPipesByRepair(pipes, repair),
+            "SEARCH PIPE BY REPAIR STATUS - Status: " + string(repair ? "On repair" : "Not on repair"));
+    }
+
+    vector<Pipe> SearchPipesByLength(const PipeManager& pipes, double minLength, double maxLength) {
+        return Collect(pipes, SelectPipesByLength(pipes, minLength, maxLength),
+            "SEARCH PIPE BY LENGTH - Range: " + to_string(minLength) + "-" + to_string(maxLength) + " km");
+    }
+
+    vector<Compress> SearchCompressByWorkshopPercentage(const CompressManager& stations, double minPercent, double maxPercent) {
+        return Collect(stations, SelectCompressByWorkshopPercentage(stations, minPercent, maxPercent),
+            "SEARCH CS BY WORKSHOP PERCENTAGE - Range: " + to_string(minPercent) + "%-" + to_string(maxPercent) + "%");
+    }
+
+    vector<Compress> SearchCompressByStatus(const CompressManager& stations, bool working) {
+        return Collect(stations, SelectCompressByStatus(stations, working),
+            "SEARCH CS BY STATUS - Status: " + string(working ? "Working" : "Not working"));
+    }
+
+    // --- Подстрочный поиск по менеджеру ---
+    // Запросы от TrigramIndex::MinQuery символов идут через триграммный индекс,
+    // короткие - проходом. Выдача ранжирована (см. SubstringRank).
+    vector<Pipe> SearchPipesByKmMark(const PipeManager& pipes, const string& kmMark) {
+        vector<SubstringRank> ranks;
+        const PipeIndexes* index = pipes.Indexes();
+        const PipeColumns* c = pipes.Columns();
+        if (!(index && MatchIndexed(pipes, index->byKmMark, kmMark, ranks, [](const Pipe& p) { return string_view(p.km_mark); }))) {
+            if (c) {
+                pipes.LiveSlots().ForEach([&](size_t i) { SubstringRank::Match(ranks, c->KmMark(i), kmMark, c->id[i]); });
+            } else {
+                for (const auto& p : pipes.GetAll()) SubstringRank::Match(ranks, p.km_mark, kmMark, p.id);
+            }
+        }
+        return CollectRanked(pipes, ranks, "SEARCH PIPE BY KM MARK - Query: '" + kmMark + "'");
+    }
+
+    vector<Compress> SearchCompressByName(const CompressManager& stations, const string& name) {
+        const CompressIndexes* index = stations.Indexes();
+        return SearchText(stations, index ? &index->byName : nullptr, name,
+            [](const Compress& c) { return string_view(c.name); }, "SEARCH CS BY NAME - Query: '" + name + "'");
+    }
+
+    vector<Compress> SearchCompressByClassification(const CompressManager& stations, const string& classification) {
+        const CompressIndexes* index = stations.Indexes();
+        return SearchText(stations, index ? &index->byClassification : nullptr, classification,
+            [](const Compress& c) { return string_view(c.classification); },
+            "SEARCH CS BY CLASSIFICATION - Query: '" + classification + "'");
+    }
+
+    vector<Compress> SearchCompressById(ItemRange<Compress> stations, int id) {
         return GenericSearchEngine<Compress>::SearchById(stations, id);
     }
 
-    vector<Compress> SearchCompressByName(const vector<Compress>& stations, const string& name) {
+    vector<Compress> SearchCompressByName(ItemRange<Compress> stations, const string& name) {
         return GenericSearchEngine<Compress>::SearchByCondition(stations,
             [&name](const Compress& c) { return c.name.find(name) != string::npos; },
             "SEARCH CS BY NAME - Query: '" + name + "'");
     }
 
-    vector<Compress> SearchCompressByClassification(const vector<Compress>& stations, const string& classification) {
+    vector<Compress> SearchCompressByClassification(ItemRange<Compress> stations, const string& classification) {
         return GenericSearchEngine<Compress>::SearchByCondition(stations,
             [&classification](const Compress& c) { return c.classification.find(classification) != string::npos; },
             "SEARCH CS BY CLASSIFICATION - Query: '" + classification + "'");
     }
 
-    vector<Compress> SearchCompressByStatus(const vector<Compress>& stations, bool working) {
+    vector<Compress> SearchCompressByStatus(ItemRange<Compress> stations, bool working) {
         return GenericSearchEngine<Compress>::SearchByCondition(stations,
             [working](const Compress& c) { return c.working == working; },
             "SEARCH CS BY STATUS - Status: " + string(working ? "Working" : "Not working"));
     }
 
-    vector<Compress> SearchCompressByWorkshopPercentage(const vector<Compress>& stations, double minPercent, double maxPercent) {
+    vector<Compress> SearchCompressByWorkshopPercentage(ItemRange<Compress> stations, double minPercent, double maxPercent) {
         return GenericSearchEngine<Compress>::SearchByCondition(stations,
             [minPercent, maxPercent](const Compress& c) { 
                 if (c.workshop_count > 0) {
@@ -112,11 +266,128 @@ public:
             "SEARCH CS BY WORKSHOP PERCENTAGE - Range: " + to_string(minPercent) + "%-" + to_string(maxPercent) + "%");
     }
 
-    vector<Compress> SearchCompressByWorkshopCount(const vector<Compress>& stations, int minCount, int maxCount) {
+    vector<Compress> SearchCompressByWorkshopCount(ItemRange<Compress> stations, int minCount, int maxCount) {
         return GenericSearchEngine<Compress>::SearchByCondition(stations,
             [minCount, maxCount](const Compress& c) { return c.workshop_working >= minCount && c.workshop_working <= maxCount; },
             "SEARCH CS BY WORKING WORKSHOPS - Range: " + to_string(minCount) + "-" + to_string(maxCount));
     }
+
+private:
+    static constexpr size_t PARALLEL_SCAN_MIN = 1 << 16;
+    // Индекс обходит дерево и ищет слот по хешу для каждого id, а колонка сканируется
+    // подряд со скоростью памяти: индекс выгоднее, только если подходит меньше 1/16 слотов
+    static constexpr size_t INDEX_SELECTIVITY_DIVISOR = 16;
+
+    template<typename T>
+    static bool IndexIsSelective(size_t estimated, const GenericManager<T>& manager) {
+        return estimated * INDEX_SELECTIVITY_DIVISOR < manager.SlotCount();
+    }
+
+    // Маска слотов без пустых: колонки и битовые поля хранят строки и для удаленных записей
+    template<typename T>
+    static SelectionBitmap LiveOnly(const GenericManager<T>& manager, SelectionBitmap result) {
+        result &= manager.LiveSlots();
+        return result;
+    }
+
+    // Большие массивы сканируются участками по общему планировщику. Границы участков
+    // кратны 64, поэтому каждое слово маски пишет только один поток.
+    template<typename T, typename Match>
+    static SelectionBitmap SelectWhere(const GenericManager<T>& manager, Match match) {
+        size_t slots = manager.SlotCount();
+        const SelectionBitmap& live = manager.LiveSlots();
+        SelectionBitmap result(slots);
+        auto scan = [&](size_t lo, size_t hi) {
+            size_t first = lo * 64, last = min(hi * 64, slots);
+            for (size_t i = first; i < last; i++) {
+                if (live.Test(i) && match(manager.AtSlot(i))) result.Set(i);
+            }
+        };
+        if (slots < PARALLEL_SCAN_MIN) {
+            scan(0, result.words.size());
+            return result;
+        }
+        TaskScheduler& scheduler = TaskScheduler::Shared();
+        scheduler.ParallelFor(0, result.words.size(), scheduler.GrainFor(result.words.size(), 4, 64), scan, "select-scan");
+        return result;
+    }
+
+    // Маска позиций по id из индекса; source(visit) вызывает visit(id) для каждого id
+    template<typename T, typename Source>
+    static SelectionBitmap SelectIds(const GenericManager<T>& manager, Source source) {
+        SelectionBitmap result(manager.SlotCount());
+        source([&](int id) {
+            long slot = manager.SlotOf(id);
+            if (slot >= 0) result.Set((size_t)slot);
+        });
+        return result;
+    }
+
+    template<typename T>
+    static SelectionBitmap SelectIdSet(const GenericManager<T>& manager, const set<int>* ids) {
+        return SelectIds(manager, [ids](auto visit) {
+            if (ids) for (int id : *ids) visit(id);
+        });
+    }
+
+    template<typename T, typename Text>
+    static SelectionBitmap SelectText(const GenericManager<T>& manager, const TrigramIndex* index, string_view query, Text text) {
+        vector<int> candidates;
+        if (index && index->Candidates(query, candidates)) {
+            return SelectIds(manager, [&](auto visit) {
+                for (int id : candidates) {
+                    const T* item = manager.FindById(id);
+                    if (item && text(*item).find(query) != string_view::npos) visit(id);
+                }
+            });
+        }
+        return SelectWhere(manager, [&](const T& item) { return text(item).find(query) != string_view::npos; });
+    }
+
+    // Ранги совпадений по кандидатам индекса; false, если индекс к запросу не применим
+    template<typename T, typename Text>
+    static bool MatchIndexed(const GenericManager<T>& manager, const TrigramIndex& index, string_view query,
+                             vector<SubstringRank>& ranks, Text text) {
+        vector<int> candidates;
+        if (!index.Candidates(query, candidates)) return false;
+        for (int id : candidates) {
+            if (const T* item = manager.FindById(id)) SubstringRank::Match(ranks, text(*item), query, id);
+        }
+        return true;
+    }
+
+    template<typename T, typename Text>
+    vector<T> SearchText(const GenericManager<T>& manager, const TrigramIndex* index, string_view query,
+                         Text text, const string& description) {
+        vector<SubstringRank> ranks;
+        if (!(index && MatchIndexed(manager, *index, query, ranks, text))) {
+            for (const auto& item : manager.GetAll()) SubstringRank::Match(ranks, text(item), query, item.id);
+        }
+        return CollectRanked(manager, ranks, description);
+    }
+
+    template<typename T>
+    vector<T> CollectRanked(const GenericManager<T>& manager, vector<SubstringRank>& ranks, const string& description) {
+        sort(ranks.begin(), ranks.end());
+        vector<T> results;
+        results.reserve(ranks.size());
+        for (const auto& rank : ranks) results.push_back(*manager.FindById(rank.id));
+        stringstream ss;
+        ss << description << " - Found: " << results.size();
+        GenericSearchEngine<T>::logger.Log(ss.str());
+        return results;
+    }
+
+    template<typename T>
+    vector<T> Collect(const GenericManager<T>& manager, const SelectionBitmap& selection, const string& description) {
+        vector<T> results;
+        results.reserve(selection.Count());
+        selection.ForEach([&](size_t slot) { results.push_back(manager.AtSlot(slot)); });
+        stringstream ss;
+        ss << description << " - Found: " << results.size();
+        GenericSearchEngine<T>::logger.Log(ss.str());
+        return results;
+    }
 };
 
 #endif
@@ -0,0 +1,212 @@
+#ifndef SECONDARY_INDEX_H
+#define SECONDARY_INDEX_H
+
+#include "structs.h"
+#include "trigram_index.h"
+#include <unordered_map>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+// Вторичные индексы менеджеров. Хранят id (а не позиции), поэтому перенос элемента
+// при удалении из GenericManager на них не влияет.
+
+// Хеш-индекс по точному значению: значение -> id по возрастанию
+template<typename Key>
+class HashIndex {
+private:
+    unordered_map<Key, set<int>> buckets;
+
+public:
+    void Insert(const Key& key, int id) { buckets[key].insert(id); }
+
+    void Erase(const Key& key, int id) {
+        auto it = buckets.find(key);
+        if (it == buckets.end()) return;
+        it->second.erase(id);
+        if (it->second.empty()) buckets.erase(it);
+    }
+
+    // nullptr, если таких значений нет
+    const set<int>* Find(const Key& key) const {
+        auto it = buckets.find(key);
+        return it == buckets.end() ? nullptr : &it->second;
+    }
+
+    size_t Count(const Key& key) const {
+        const set<int>* ids = Find(key);
+        return ids ? ids->size() : 0;
+    }
+
+    void Clear() { buckets.clear(); }
+};
+
+// Упорядоченный индекс по числовому значению для запросов по диапазону
+class RangeIndex {
+private:
+    set<pair<double, int>> entries;
+
+public:
+    void Insert(double key, int id) { entries.insert({key, id}); }
+    void Erase(double key, int id) { entries.erase({key, id}); }
+    size_t Size() const { return entries.size(); }
+    void Clear() { entries.clear(); }
+
+    // Оценка числа id в [lo, hi] при равномерном распределении значений (для планировщика)
+    size_t EstimateInRange(double lo, double hi) const {
+        if (entries.empty() || !(lo <= hi)) return 0;
+        double first = entries.begin()->first, last = entries.rbegin()->first;
+        if (hi < first || lo > last) return 0;
+        if (first == last) return entries.size();
+        double covered = (min(hi, last) - max(lo, first)) / (last - first);
+        return max((size_t)1, (size_t)(covered * (double)entries.size() + 0.5));
+    }
+
+    // Обход id со значением в [lo, hi] по возрастанию значения
+    template<typename Visitor>
+    void ForEachInRange(double lo, double hi, Visitor visit) const {
+        if (!(lo <= hi)) return;
+        for (auto it = entries.lower_bound({lo, INT_MIN}); it != entries.end() && it->first <= hi; ++it) {
+            visit(it->second);
+        }
+    }
+};
+
+// Битовый индекс признака: бит номер id установлен, если признак истинен
+class IdBitmap {
+private:
+    vector<uint64_t> words;
+    size_t count = 0;
+
+public:
+    bool Test(int id) const {
+        size_t k = (size_t)id >> 6;
+        return id >= 0 && k < words.size() && ((words[k] >> (id & 63)) & 1);
+    }
+
+    void Set(int id, bool value) {
+        if (id < 0 || Test(id) == value) return;
+        size_t k = (size_t)id >> 6;
+        if (k >= words.size()) words.resize(k + 1, 0);
+        words[k] ^= uint64_t(1) << (id & 63);
+        value ? count++ : count--;
+    }
+
+    size_t Count() const { return count; }
+
+    void Clear() {
+        words.clear();
+        count = 0;
+    }
+
+    template<typename Visitor>
+    void ForEach(Visitor visit) const {
+        for (size_t k = 0; k < words.size(); k++) {
+            uint64_t w = words[k];
+            while (w) {
+                visit((int)(k * 64 + (size_t)__builtin_ctzll(w)));
+                w &= w - 1;
+            }
+        }
+    }
+};
+
+// --- Наборы индексов менеджеров ---
+
+struct PipeIndexes {
+    HashIndex<int> byDiameter;
+    HashIndex<bool> byRepair;
+    RangeIndex byLength;
+    TrigramIndex byKmMark;
+
+    void Insert(const Pipe& pipe) {
+        byDiameter.Insert(pipe.diametr, pipe.id);
+        byRepair.Insert(pipe.repair, pipe.id);
+        byLength.Insert(pipe.length, pipe.id);
+        byKmMark.Insert(pipe.km_mark, pipe.id);
+    }
+
+    void Erase(const Pipe& pipe) {
+        byDiameter.Erase(pipe.diametr, pipe.id);
+        byRepair.Erase(pipe.repair, pipe.id);
+        byLength.Erase(pipe.length, pipe.id);
+        byKmMark.Erase(pipe.km_mark, pipe.id);
+    }
+
+    void Update(const Pipe& before, const Pipe& after) {
+        if (before.diametr != after.diametr) {
+            byDiameter.Erase(before.diametr, before.id);
+            byDiameter.Insert(after.diametr, after.id);
+        }
+        if (before.repair != after.repair) {
+            byRepair.Erase(before.repair, before.id);
+            byRepair.Insert(after.repair, after.id);
+        }
+        if (before.length != after.length) {
+            byLength.Erase(before.length, before.id);
+            byLength.Insert(after.length, after.id);
+        }
+        byKmMark.Update(before.km_mark, after.km_mark, after.id);
+    }
+
+    void Clear() {
+        byDiameter.Clear();
+        byRepair.Clear();
+        byLength.Clear();
+        byKmMark.Clear();
+    }
+};
+
+struct CompressIndexes {
+    RangeIndex byWorkshopPercentage;   // станции без цехов не индексируются
+    IdBitmap working;
+    TrigramIndex byName;
+    TrigramIndex byClassification;
+
+    // Загрузка цехов в процентах; false, если цехов нет
+    static bool WorkshopPercentage(const Compress& station, double& percentage) {
+        if (station.workshop_count <= 0) return false;
+        percentage = (double)station.workshop_working / station.workshop_count * 100;
+        return true;
+    }
+
+    void Insert(const Compress& station) {
+        double percentage;
+        if (WorkshopPercentage(station, percentage)) byWorkshopPercentage.Insert(percentage, station.id);
+        working.Set(station.id, station.working);
+        byName.Insert(station.name, station.id);
+        byClassification.Insert(station.classification, station.id);
+    }
+
+    void Erase(const Compress& station) {
+        double percentage;
+        if (WorkshopPercentage(station, percentage)) byWorkshopPercentage.Erase(percentage, station.id);
+        working.Set(station.id, false);
+        byName.Erase(station.name, station.id);
+        byClassification.Erase(station.classification, station.id);
+    }
+
+    void Update(const Compress& before, const Compress& after) {
+        if (before.workshop_count != after.workshop_count || before.workshop_working != after.workshop_working) {
+            double percentage;
+            if (WorkshopPercentage(before, percentage)) byWorkshopPercentage.Erase(percentage, before.id);
+            if (WorkshopPercentage(after, percentage)) byWorkshopPercentage.Insert(percentage, after.id);
+        }
+        working.Set(after.id, after.working);
+        byName.Update(before.name, after.name, after.id);
+        byClassification.Update(before.classification, after.classification, after.id);
+    }
+
+    void Clear() {
+        byWorkshopPercentage.Clear();
+        working.Clear();
+        byName.Clear();
+        byClassification.Clear();
+    }
+};
+
+#endif
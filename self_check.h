@@ -0,0 +1,396 @@
+#ifndef SELF_CHECK_H
+#define SELF_CHECK_H
+
+#include "pipe_manager.h"
+#include "compress_manager.h"
+#include "network_manager.h"
+#include "network_versions.h"
+#include "journal.h"
+#include "scan_kernels.h"
+#include "text_parser.h"
+#include "logger.h"
+#include <vector>
+#include <string>
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+
+// Перекрестная проверка движков на случайных сетях, без изменения рабочих данных:
+// каждый ускоренный расчет сравнивается с простым эталоном (Дейкстра и т.п.).
+// Запускается командой selfcheck пакетного режима, в том числе без участия оператора (CI).
+class SelfCheck {
+private:
+    static constexpr double EPS = 1e-6;
+    static constexpr int DIAMETERS[] = {500, 700, 1000, 1400};
+
+    Logger quiet{"/dev/null"};   // тестовые менеджеры не пишут в журнал операций
+    mt19937 random;
+    size_t checks = 0;
+    vector<string> failures;
+
+public:
+    explicit SelfCheck(unsigned seed) : random(seed) {}
+
+    // rounds - число случайных сетей
+    void Run(int rounds) {
+        for (int round = 0; round < rounds; round++) {
+            CheckNetwork(round);
+            CheckJournal(round);
+            CheckBulkInsert(round);
+            CheckKernels(round);
+        }
+        CheckParser();
+    }
+
+    size_t Checks() const { return checks; }
+    const vector<string>& Failures() const { return failures; }
+
+private:
+    bool Expect(bool ok, const string& what) {
+        checks++;
+        if (!ok) failures.push_back(what);
+        return ok;
+    }
+
+    static bool Near(double a, double b) {
+        if (a == b) return true;   // в том числе обе бесконечности
+        return fabs(a - b) <= EPS * max(1.0, max(fabs(a), fabs(b)));
+    }
+
+    int Uniform(int lo, int hi) { return uniform_int_distribution<int>(lo, hi)(random); }
+
+    // Случайная сеть: часть труб не подключена, часть в ремонте
+    void BuildNetwork(PipeManager& pipes, CompressManager& stations, int stationCount, int pipeCount) {
+        for (int i = 0; i < stationCount; i++) AddStation(stations);
+        for (int i = 0; i < pipeCount; i++) AddPipe(pipes, stationCount);
+    }
+
+    void AddStation(CompressManager& stations) {
+        Compress station = {};
+        station.name = "CS";
+        station.workshop_count = Uniform(1, 10);
+        station.workshop_working = Uniform(0, station.workshop_count);
+        station.classification = "A";
+        station.working = true;
+        stations.Emplace(move(station));
+    }
+
+    void AddPipe(PipeManager& pipes, int maxStationId) { pipes.Emplace(RandomPipe(maxStationId)); }
+
+    // Концы подключенной трубы - станции с id из [1, maxStationId], maxStationId >= 2
+    Pipe RandomPipe(int maxStationId) {
+        Pipe pipe = {};
+        pipe.km_mark = "km" + to_string(Uniform(0, 999));
+        pipe.length = Uniform(1, 100);
+        pipe.diametr = DIAMETERS[Uniform(0, 3)];
+        pipe.repair = Uniform(0, 9) == 0;
+        if (Uniform(0, 9) != 0) {
+            pipe.source_cs_id = Uniform(1, maxStationId);
+            do pipe.dest_cs_id = Uniform(1, maxStationId); while (pipe.dest_cs_id == pipe.source_cs_id);
+        }
+        return pipe;
+    }
+
+    void CheckNetwork(int round) {
+        int pid = 1, cid = 1;
+        PipeManager pipes(pid, quiet);
+        CompressManager stations(cid, quiet);
+        int stationCount = Uniform(10, 60);
+        BuildNetwork(pipes, stations, stationCount, stationCount * Uniform(2, 6));
+        string where = "round " + to_string(round);
+
+        // Один менеджер и один читатель версий живут все шаги: их кэши потока
+        // и иерархии донастраиваются после переключений ремонта
+        NetworkManager cached(pipes, stations);
+        VersionedNetwork versions(pipes, stations);
+        NetworkReader reader(versions);
+        for (int step = 0; step < 4; step++) {
+            string at = where + " step " + to_string(step);
+            reader.Pin();
+            CheckDistanceMatrix(cached, stationCount, at);
+            for (int k = 0; k < 8; k++) {
+                int s = Uniform(1, stationCount), t = Uniform(1, stationCount);
+                string pair = at + " " + to_string(s) + "->" + to_string(t);
+                CheckPaths(cached, s, t, pair);
+                CheckReader(reader, cached, s, t, pair);
+                if (s != t) CheckFlows(cached, pipes, stations, s, t, pair);
+            }
+            // Переключение ремонта у нескольких труб
+            versions.Write([&](PipeManager& writable, CompressManager&) {
+                for (int k = 0; k < 5; k++) {
+                    int id = Uniform(1, pid - 1);
+                    if (const Pipe* p = writable.FindById(id)) writable.SetRepair(id, !p->repair);
+                }
+            });
+        }
+    }
+
+    void CheckPaths(NetworkManager& network, int s, int t, const string& where) {
+        ShortestPathResult base = network.ComputeShortestPath(s, t, PathAlgorithm::Dijkstra);
+        const pair<PathAlgorithm, const char*> others[] = {
+            {PathAlgorithm::Bidirectional, "bidirectional"},
+            {PathAlgorithm::ALT, "alt"},
+            {PathAlgorithm::ContractionHierarchy, "ch"}};
+        for (const auto& other : others) {
+            ShortestPathResult result = network.ComputeShortestPath(s, t, other.first);
+            Expect(result.found == base.found && (!base.found || Near(result.length, base.length)),
+                   string("path ") + other.second + " vs dijkstra, " + where + ": " +
+                   (result.found ? to_string(result.length) : "none") + " != " + (base.found ? to_string(base.length) : "none"));
+        }
+    }
+
+    // cached донастраивает найденные раньше потоки после переключений ремонта, fresh считает с нуля
+    // Иерархия читателя переживает смену версий с общей структурой графа
+    void CheckReader(NetworkReader& reader, NetworkManager& network, int s, int t, const string& where) {
+        ShortestPathResult base = network.ComputeShortestPath(s, t, PathAlgorithm::Dijkstra);
+        ShortestPathResult result = reader.ComputeShortestPath(s, t, PathAlgorithm::ContractionHierarchy);
+        Expect(result.found == base.found && (!base.found || Near(result.length, base.length)),
+               "reader ch vs dijkstra, " + where + ": " +
+               (result.found ? to_string(result.length) : "none") + " != " + (base.found ? to_string(base.length) : "none"));
+    }
+
+    void CheckFlows(NetworkManager& cached, PipeManager& pipes, CompressManager& stations, int s, int t, const string& where) {
+        NetworkManager fresh(pipes, stations);
+        MaxFlowResult dinic = fresh.ComputeMaxFlow(s, t, MaxFlowAlgorithm::Dinic);
+        MaxFlowResult pushRelabel = fresh.ComputeMaxFlow(s, t, MaxFlowAlgorithm::PushRelabel);
+        MaxFlowResult repaired = cached.ComputeMaxFlow(s, t, MaxFlowAlgorithm::Dinic);
+        Expect(dinic.error == pushRelabel.error && Near(dinic.totalFlow, pushRelabel.totalFlow),
+               "flow dinic vs push-relabel, " + where + ": " + to_string(dinic.totalFlow) + " != " + to_string(pushRelabel.totalFlow));
+        Expect(dinic.error == repaired.error && Near(dinic.totalFlow, repaired.totalFlow),
+               "flow repaired vs fresh, " + where + ": " + to_string(repaired.totalFlow) + " != " + to_string(dinic.totalFlow));
+    }
+
+    // Строки матрицы от нескольких источников против одиночных запросов Дейкстры
+    void CheckDistanceMatrix(NetworkManager& network, int stationCount, const string& where) {
+        vector<int> sources, targets;
+        for (int k = 0; k < 4; k++) sources.push_back(Uniform(1, stationCount));
+        for (int id = 1; id <= stationCount; id++) targets.push_back(id);
+        DistanceMatrix matrix = network.ComputeDistanceMatrix(sources, targets);
+        for (size_t i = 0; i < sources.size(); i++) {
+            for (size_t j = 0; j < targets.size(); j++) {
+                ShortestPathResult path = network.ComputeShortestPath(sources[i], targets[j]);
+                double expected = path.found ? path.length : numeric_limits<double>::infinity();
+                bool predecessor = path.found && path.stations.size() > 1 ? matrix.PredecessorAt(i, j) != -1
+                                                                          : matrix.PredecessorAt(i, j) == -1;
+                Expect(Near(matrix.At(i, j), expected) && predecessor,
+                       "distance matrix vs dijkstra, " + where + " " + to_string(sources[i]) + "->" + to_string(targets[j]) +
+                       ": " + to_string(matrix.At(i, j)) + " != " + to_string(expected));
+            }
+        }
+    }
+
+    // Изменения, записанные журналом, и их повтор поверх копии исходного состояния
+    void CheckJournal(int round) {
+        int pid = 1, cid = 1, copyPid = 1, copyCid = 1;
+        PipeManager pipes(pid, quiet);
+        CompressManager stations(cid, quiet);
+        PipeManager copyPipes(copyPid, quiet);
+        CompressManager copyStations(copyCid, quiet);
+        int stationCount = Uniform(5, 30);
+        BuildNetwork(pipes, stations, stationCount, stationCount * 3);
+        for (const Pipe& p : pipes.GetAll()) copyPipes.Restore(p);
+        for (const Compress& c : stations.GetAll()) copyStations.Restore(c);
+
+        char path[] = "/tmp/selfcheck-XXXXXX";
+        int fd = mkstemp(path);
+        if (!Expect(fd != -1, "journal: could not create a temporary file")) return;
+        ::close(fd);
+
+        Journal journal;
+        journal.Attach(pipes, stations);
+        for (int k = 0; k < 200; k++) {
+            int op = Uniform(0, 5);
+            int pipeId = Uniform(1, pid), stationId = Uniform(1, cid);
+            if (op == 0) {
+                AddStation(stations);
+                AddPipe(pipes, cid - 1);
+            }
+            else if (op == 1) pipes.Delete(pipeId);
+            else if (op == 2) stations.Delete(stationId);
+            else if (op == 3) stations.Edit(stationId, [k](Compress& c) { c.name = "renamed" + to_string(k); });
+            else if (const Pipe* p = pipes.FindById(pipeId)) pipes.SetRepair(pipeId, !p->repair);
+            if (k % 50 == 49) journal.Commit(path);   // несколько групп записей подряд
+        }
+        bool committed = journal.Commit(path);
+        journal.Detach();
+        JournalReplayStats stats = journal.Replay(path, copyPipes, copyStations);
+        ::unlink(path);
+
+        string where = "journal round " + to_string(round);
+        if (!Expect(committed && stats.error.empty() && stats.tornBytes == 0, where + ": replay failed " + stats.error)) return;
+        Expect(SamePipes(pipes, copyPipes), where + ": pipes differ after replay");
+        Expect(SameStations(stations, copyStations), where + ": stations differ after replay");
+    }
+
+    static bool SamePipes(const PipeManager& a, const PipeManager& b) {
+        if (a.GetAll().size() != b.GetAll().size()) return false;
+        for (const Pipe& p : a.GetAll()) {
+            const Pipe* q = b.FindById(p.id);
+            if (!q || q->km_mark != p.km_mark || q->length != p.length || q->diametr != p.diametr ||
+                q->repair != p.repair || q->source_cs_id != p.source_cs_id || q->dest_cs_id != p.dest_cs_id) return false;
+        }
+        return true;
+    }
+
+    static bool SameStations(const CompressManager& a, const CompressManager& b) {
+        if (a.GetAll().size() != b.GetAll().size()) return false;
+        for (const Compress& c : a.GetAll()) {
+            const Compress* d = b.FindById(c.id);
+            if (!d || d->name != c.name || d->workshop_count != c.workshop_count || d->workshop_working != c.workshop_working ||
+                d->classification != c.classification || d->working != c.working) return false;
+        }
+        return true;
+    }
+
+    // Пакетная вставка поверх менеджера с удаленными слотами: непрерывный блок id,
+    // а колонки, индексы и пул свободных труб согласованы с самими трубами
+    void CheckBulkInsert(int round) {
+        int pid = 1;
+        PipeManager pipes(pid, quiet);
+        pipes.EnableColumns();
+        pipes.EnableIndexes();
+        int stationCount = Uniform(2, 20);
+        int existing = Uniform(0, 50);
+        for (int i = 0; i < existing; i++) AddPipe(pipes, stationCount);
+        for (int k = 0; k < 10; k++) pipes.Delete(Uniform(1, pid));
+
+        // Больше блока хранилища и не кратно слову маски
+        vector<Pipe> batch(Uniform(1, 3000));
+        for (Pipe& pipe : batch) pipe = RandomPipe(stationCount);
+        vector<Pipe> expected = batch;
+        int next = pipes.NextId();
+        vector<int> seen;
+        int first = pipes.AddRange(move(batch), [&](const Pipe& p) { seen.push_back(p.id); });
+
+        string where = "bulk insert round " + to_string(round);
+        bool contiguous = first == next && pipes.NextId() == next + (int)expected.size() && seen.size() == expected.size();
+        bool stored = true;
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (contiguous && seen[i] != first + (int)i) contiguous = false;
+            const Pipe* p = pipes.FindById(first + (int)i);
+            if (!p || p->km_mark != expected[i].km_mark || p->length != expected[i].length || p->diametr != expected[i].diametr ||
+                p->repair != expected[i].repair || p->source_cs_id != expected[i].source_cs_id || p->dest_cs_id != expected[i].dest_cs_id) stored = false;
+        }
+        Expect(contiguous, where + ": ids are not one contiguous block from " + to_string(next));
+        Expect(stored, where + ": stored pipes differ from the batch");
+        Expect(SameColumns(pipes), where + ": columns differ from pipes");
+        Expect(SameIndexes(pipes), where + ": indexes differ from pipes");
+        Expect(SameFreePool(pipes), where + ": free-pipe pool differs from pipes");
+    }
+
+    static bool SameColumns(const PipeManager& pipes) {
+        const PipeColumns& columns = *pipes.Columns();
+        if (columns.Size() != pipes.SlotCount()) return false;
+        for (const Pipe& p : pipes.GetAll()) {
+            size_t i = (size_t)pipes.SlotOf(p.id);
+            PipeRow row = columns.Row(i);
+            if (row.id != p.id || row.length != p.length || row.diametr != p.diametr || row.repair != p.repair ||
+                row.source_cs_id != p.source_cs_id || row.dest_cs_id != p.dest_cs_id || columns.KmMark(i) != p.km_mark) return false;
+        }
+        return true;
+    }
+
+    static bool SameIndexes(const PipeManager& pipes) {
+        const PipeIndexes& indexes = *pipes.Indexes();
+        size_t byDiameter = 0, byLength = 0;
+        for (int d : DIAMETERS) byDiameter += indexes.byDiameter.Count(d);
+        indexes.byLength.ForEachInRange(-numeric_limits<double>::infinity(), numeric_limits<double>::infinity(), [&](int) { byLength++; });
+        size_t count = pipes.GetAll().size();
+        if (byDiameter != count || byLength != count || indexes.byRepair.Count(true) + indexes.byRepair.Count(false) != count) return false;
+        for (const Pipe& p : pipes.GetAll()) {
+            const set<int>* sameDiameter = indexes.byDiameter.Find(p.diametr);
+            const set<int>* sameRepair = indexes.byRepair.Find(p.repair);
+            if (!sameDiameter || !sameDiameter->count(p.id) || !sameRepair || !sameRepair->count(p.id)) return false;
+        }
+        return true;
+    }
+
+    // В пуле - свободная труба каждого диаметра с наименьшим id
+    static bool SameFreePool(const PipeManager& pipes) {
+        for (int d : DIAMETERS) {
+            int expected = -1;
+            for (const Pipe& p : pipes.GetAll()) {
+                if (p.diametr == d && p.source_cs_id == 0 && p.dest_cs_id == 0 && (expected == -1 || p.id < expected)) expected = p.id;
+            }
+            if (pipes.FindFreePipeID(d) != expected) return false;
+        }
+        return true;
+    }
+
+    // Векторные ядра фильтров против скалярных на случайных колонках: длины не кратны 8 и 64,
+    // длина NaN (так ClearRow помечает удаленную строку), станции без цехов (den == 0)
+    void CheckKernels(int round) {
+        size_t n = (size_t)Uniform(0, 300);
+        vector<int> diameters(n), working(n), workshops(n);
+        vector<double> lengths(n);
+        for (size_t i = 0; i < n; i++) {
+            diameters[i] = Uniform(0, 4) == 0 ? 0 : DIAMETERS[Uniform(0, 3)];
+            lengths[i] = Uniform(0, 9) == 0 ? numeric_limits<double>::quiet_NaN() : Uniform(1, 100) + Uniform(0, 1) * 0.5;
+            workshops[i] = Uniform(0, 10);
+            working[i] = Uniform(0, workshops[i]);
+        }
+        int diameter = DIAMETERS[Uniform(0, 3)];
+        double lo = Uniform(0, 60), hi = lo + Uniform(0, 60);
+        double percentLo = Uniform(0, 100), percentHi = percentLo + Uniform(0, 50);
+
+        string where = "scan kernels round " + to_string(round) + ", " + to_string(n) + " rows";
+        SelectionBitmap expected(n);
+        ScanKernels::EqualIntScalar(diameters.data(), 0, n, diameter, expected.words.data());
+        Expect(ScanKernels::SelectEqual(diameters, diameter).words == expected.words, where + ": equal differs from scalar");
+
+        expected.Reset(n);
+        ScanKernels::RangeDoubleScalar(lengths.data(), 0, n, lo, hi, expected.words.data());
+        Expect(ScanKernels::SelectRange(lengths, lo, hi).words == expected.words, where + ": range differs from scalar");
+
+        expected.Reset(n);
+        ScanKernels::PercentRangeScalar(working.data(), workshops.data(), 0, n, percentLo, percentHi, expected.words.data());
+        Expect(ScanKernels::SelectPercentRange(working, workshops, percentLo, percentHi).words == expected.words,
+               where + ": percent range differs from scalar");
+    }
+
+    // Ошибка разбора должна указывать строку и колонку неверного значения
+    void CheckParser() {
+        struct Case {
+            const char* text;
+            const char* position;
+        };
+        const Case cases[] = {
+            {"===== PIPES DATA =====\nID: 1\nLength (km): abc\n", "line 3, column 14"},
+            {"===== PIPES DATA =====\nID: 1\nDiameter (mm): 70x\n", "line 3, column 18"},
+            {"===== COMPRESSOR STATIONS DATA =====\nID: 2\nActive: maybe\n", "line 3, column 9"},
+            {"===== PIPES DATA =====\nID: 1\n~~~\nKM Mark: x\n~~~\n", "line 4, column 1"},
+            {"===== PIPES DATA =====\nID: 1\nColor: red\n", "line 3, column 1"},
+        };
+        auto ignore = [](const auto&) {};
+        for (const Case& c : cases) {
+            TextDataParser streamed;
+            istringstream in(c.text);
+            bool streamOk = streamed.Parse(in, ignore, ignore);
+            string expected = string(c.position) + ":";
+            Expect(!streamOk && streamed.Diagnostic().compare(0, expected.size(), expected) == 0,
+                   string("parser: expected ") + c.position + ", got '" + streamed.Diagnostic() + "'");
+
+            // Как при параллельной загрузке: участки по границам записей, номер строки со сдвигом
+            string_view text(c.text);
+            for (size_t parts = 1; parts <= 3; parts++) {
+                string diagnostic;
+                for (const TextChunk& chunk : TextDataParser::SplitIntoChunks(text, parts)) {
+                    TextDataParser parser;
+                    if (parser.ParseText(text.substr(chunk.begin, chunk.end - chunk.begin), chunk.section, ignore, ignore)) continue;
+                    diagnostic = parser.Diagnostic(count(text.begin(), text.begin() + chunk.begin, '\n'));
+                    break;
+                }
+                Expect(diagnostic == streamed.Diagnostic(), "parser: " + to_string(parts) + " parts '" + diagnostic +
+                       "' != streamed '" + streamed.Diagnostic() + "'");
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef SHORTEST_PATH_H
+#define SHORTEST_PATH_H
+
+#include "network_graph.h"
+#include <vector>
+#include <string>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+enum class PathAlgorithm {
+    Dijkstra,       // классический однонаправленный поиск
+    Bidirectional,  // встречный поиск от начала и от конца
+    ALT,            // A* с ориентирами (landmarks) и неравенством треугольника
+    ContractionHierarchy // запрос по иерархии сжатия (требует предобработки)
+};
+
+struct ShortestPathResult {
+    string error;                 // пусто, если станции найдены
+    bool found = false;           // существует ли путь
+    double length = 0;
+    vector<int> stations;         // ID КС по порядку
+    vector<int> pipes;            // ID труб между ними
+    size_t settled = 0;           // сколько вершин обработано (для оценки ускорения)
+};
+
+// Матрица расстояний: строка - источник, столбец - цель
+struct DistanceMatrix {
+    vector<int> sources;          // ID КС-источников
+    vector<int> targets;          // ID КС-целей
+    vector<double> distance;      // sources.size() x targets.size(), infinity - нет пути
+    vector<int> predecessor;      // ID КС, предшествующей цели на кратчайшем пути (-1 - нет)
+
+    double At(size_t row, size_t col) const { return distance[row * targets.size() + col]; }
+    int PredecessorAt(size_t row, size_t col) const { return predecessor[row * targets.size() + col]; }
+};
+
+// Дейкстра по CSR-графу с переиспользуемыми буферами.
+// Каждому потоку нужен свой экземпляр; сам граф только читается.
+class DijkstraSearch {
+private:
+    const NetworkGraph& g;
+    vector<double> dist;
+    vector<int> parentEdge;
+    vector<int> touched;          // вершины, которые нужно сбросить перед следующим запуском
+    vector<pair<double, int>> heap;
+
+public:
+    explicit DijkstraSearch(const NetworkGraph& graph)
+        : g(graph), dist(graph.VertexCount(), numeric_limits<double>::infinity()),
+          parentEdge(graph.VertexCount(), -1) {}
+
+    // Поиск от s; если t >= 0, останавливается при достижении t. Возвращает число обработанных вершин.
+    size_t Run(int s, int t = -1) {
+        for (int v : touched) {
+            dist[v] = numeric_limits<double>::infinity();
+            parentEdge[v] = -1;
+        }
+        touched.clear();
+        heap.clear();
+
+        size_t settled = 0;
+        dist[s] = 0;
+        touched.push_back(s);
+        heap.push_back({0, s});
+
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+            double d = heap.back().first;
+            int u = heap.back().second;
+            heap.pop_back();
+
+            if (d > dist[u]) continue;
+            settled++;
+            if (u == t) break;
+
+            // Трубы в ремонте не используем
+            for (int e = g.outStart[u]; e < g.outStart[u + 1]; e++) {
+                if (g.edgeRepair[e]) continue;
+                int v = g.edgeTo[e];
+                double nd = d + g.edgeLength[e];
+                if (nd < dist[v]) {
+                    if (dist[v] == numeric_limits<double>::infinity()) touched.push_back(v);
+                    dist[v] = nd;
+                    parentEdge[v] = e;
+                    heap.push_back({nd, v});
+                    push_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+                }
+            }
+        }
+        return settled;
+    }
+
+    double Distance(int v) const { return dist[v]; }
+    int ParentEdge(int v) const { return parentEdge[v]; }
+
+    // Восстановление пути s -> t после Run
+    void ExtractPath(int s, int t, ShortestPathResult& result) const {
+        result.found = dist[t] != numeric_limits<double>::infinity();
+        if (!result.found) return;
+        result.length = dist[t];
+
+        vector<int> edges;
+        for (int v = t; v != s; v = g.edgeFrom[parentEdge[v]]) edges.push_back(parentEdge[v]);
+        reverse(edges.begin(), edges.end());
+
+        result.stations.push_back(g.stationIds[s]);
+        for (int e : edges) {
+            result.pipes.push_back(g.edgePipe[e]);
+            result.stations.push_back(g.stationIds[g.edgeTo[e]]);
+        }
+    }
+};
+
+// Встречная Дейкстра: прямой поиск по исходящим ребрам, обратный - по входящим
+class BidirectionalSearch {
+private:
+    const NetworkGraph& g;
+    vector<double> dist[2];
+    vector<int> parentEdge[2];    // для обратного поиска - ребро к следующей вершине пути
+    vector<char> settledFlag[2];
+    vector<int> touched;
+    vector<pair<double, int>> heap[2];
+
+public:
+    explicit BidirectionalSearch(const NetworkGraph& graph) : g(graph) {
+        for (int side = 0; side < 2; side++) {
+            dist[side].assign(g.VertexCount(), numeric_limits<double>::infinity());
+            parentEdge[side].assign(g.VertexCount(), -1);
+            settledFlag[side].assign(g.VertexCount(), 0);
+        }
+    }
+
+    void Run(int s, int t, ShortestPathResult& result) {
+        for (int v : touched) {
+            for (int side = 0; side < 2; side++) {
+                dist[side][v] = numeric_limits<double>::infinity();
+                parentEdge[side][v] = -1;
+                settledFlag[side][v] = 0;
+            }
+        }
+        touched.clear();
+
+        const double INF = numeric_limits<double>::infinity();
+        auto cmp = greater<pair<double, int>>();
+        double best = INF;
+        int meet = -1;
+
+        for (int side = 0; side < 2; side++) heap[side].clear();
+        dist[0][s] = 0; heap[0].push_back({0, s});
+        dist[1][t] = 0; heap[1].push_back({0, t});
+        touched.push_back(s);
+        touched.push_back(t);
+
+        while (!heap[0].empty() && !heap[1].empty()) {
+            // Путь короче best уже не найти
+            if (heap[0].front().first + heap[1].front().first >= best) break;
+
+            int side = heap[0].size() <= heap[1].size() ? 0 : 1;
+            pop_heap(heap[side].begin(), heap[side].end(), cmp);
+            double d = heap[side].back().first;
+            int u = heap[side].back().second;
+            heap[side].pop_back();
+            if (d > dist[side][u] || settledFlag[side][u]) continue;
+            settledFlag[side][u] = 1;
+            result.settled++;
+
+            int from = side == 0 ? g.outStart[u] : g.inStart[u];
+            int to = side == 0 ? g.outStart[u + 1] : g.inStart[u + 1];
+            for (int i = from; i < to; i++) {
+                int e = side == 0 ? i : g.inEdge[i];
+                if (g.edgeRepair[e]) continue;
+                int v = side == 0 ? g.edgeTo[e] : g.edgeFrom[e];
+                double nd = d + g.edgeLength[e];
+                if (nd < dist[side][v]) {
+                    if (dist[0][v] == INF && dist[1][v] == INF) touched.push_back(v);
+                    dist[side][v] = nd;
+                    parentEdge[side][v] = e;
+                    heap[side].push_back({nd, v});
+                    push_heap(heap[side].begin(), heap[side].end(), cmp);
+                }
+                if (dist[side][v] + dist[1 - side][v] < best) {
+                    best = dist[side][v] + dist[1 - side][v];
+                    meet = v;
+                }
+            }
+        }
+
+        if (s == t) { best = 0; meet = s; }
+        result.found = best != INF;
+        if (!result.found) return;
+        result.length = best;
+
+        vector<int> edges;
+        for (int v = meet; v != s; v = g.edgeFrom[parentEdge[0][v]]) edges.push_back(parentEdge[0][v]);
+        reverse(edges.begin(), edges.end());
+        for (int v = meet; v != t; v = g.edgeTo[parentEdge[1][v]]) edges.push_back(parentEdge[1][v]);
+
+        result.stations.push_back(g.stationIds[s]);
+        for (int e : edges) {
+            result.pipes.push_back(g.edgePipe[e]);
+            result.stations.push_back(g.stationIds[g.edgeTo[e]]);
+        }
+    }
+};
+
+// A* с ориентирами (ALT). Для набора ориентиров L заранее считаются d(L, v) и d(v, L);
+// оценка снизу d(v, t) >= max(d(v, L) - d(t, L), d(L, t) - d(L, v)).
+class LandmarkSearch {
+private:
+    const NetworkGraph& g;
+    vector<int> landmarks;
+    vector<double> fromLandmark;  // [k * n]: d(L_k, v)
+    vector<double> toLandmark;    // [k * n]: d(v, L_k)
+
+    vector<double> dist;
+    vector<double> potential;
+    vector<int> parentEdge;
+    vector<int> touched;
+    vector<pair<double, int>> heap;
+
+public:
+    LandmarkSearch(const NetworkGraph& graph, int landmarkCount = 8) : g(graph) {
+        int n = g.VertexCount();
+        SelectLandmarks(min(landmarkCount, n));
+        size_t k = landmarks.size();
+        fromLandmark.assign(k * n, 0);
+        toLandmark.assign(k * n, 0);
+        for (size_t i = 0; i < k; i++) {
+            FullDistances(landmarks[i], false, &fromLandmark[i * n]);
+            FullDistances(landmarks[i], true, &toLandmark[i * n]);
+        }
+        dist.assign(n, numeric_limits<double>::infinity());
+        potential.assign(n, -1);
+        parentEdge.assign(n, -1);
+    }
+
+    const vector<int>& Landmarks() const { return landmarks; }
+
+    void Run(int s, int t, ShortestPathResult& result) {
+        for (int v : touched) {
+            dist[v] = numeric_limits<double>::infinity();
+            potential[v] = -1;
+            parentEdge[v] = -1;
+        }
+        touched.clear();
+        heap.clear();
+
+        const double INF = numeric_limits<double>::infinity();
+        auto cmp = greater<pair<double, int>>();
+        dist[s] = 0;
+        touched.push_back(s);
+        heap.push_back({Potential(s, t), s});
+
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), cmp);
+            double key = heap.back().first;
+            int u = heap.back().second;
+            heap.pop_back();
+            if (key > dist[u] + potential[u]) continue;
+            result.settled++;
+            if (u == t) break;
+
+            for (int e = g.outStart[u]; e < g.outStart[u + 1]; e++) {
+                if (g.edgeRepair[e]) continue;
+                int v = g.edgeTo[e];
+                double nd = dist[u] + g.edgeLength[e];
+                if (nd < dist[v]) {
+                    if (dist[v] == INF) touched.push_back(v);
+                    double pv = Potential(v, t);
+                    if (pv == INF) continue; // из v цель недостижима
+                    dist[v] = nd;
+                    parentEdge[v] = e;
+                    heap.push_back({nd + pv, v});
+                    push_heap(heap.begin(), heap.end(), cmp);
+                }
+            }
+        }
+
+        result.found = dist[t] != INF;
+        if (!result.found) return;
+        result.length = dist[t];
+
+        vector<int> edges;
+        for (int v = t; v != s; v = g.edgeFrom[parentEdge[v]]) edges.push_back(parentEdge[v]);
+        reverse(edges.begin(), edges.end());
+        result.stations.push_back(g.stationIds[s]);
+        for (int e : edges) {
+            result.pipes.push_back(g.edgePipe[e]);
+            result.stations.push_back(g.stationIds[g.edgeTo[e]]);
+        }
+    }
+
+private:
+    // Оценка снизу расстояния v -> t (кэшируется до конца запроса)
+    double Potential(int v, int t) {
+        if (potential[v] >= 0) return potential[v];
+        const double INF = numeric_limits<double>::infinity();
+        int n = g.VertexCount();
+        double bound = 0;
+        for (size_t i = 0; i < landmarks.size(); i++) {
+            const double* from = &fromLandmark[i * n];
+            const double* to = &toLandmark[i * n];
+            // d(v, L) - d(t, L): если t достигает L, а v - нет, то v не достигает и t
+            if (to[t] != INF) bound = max(bound, to[v] == INF ? INF : to[v] - to[t]);
+            // d(L, t) - d(L, v): если L достигает v, но не t, то v не достигает t
+            if (from[v] != INF) bound = max(bound, from[t] == INF ? INF : from[t] - from[v]);
+        }
+        potential[v] = bound;
+        return bound;
+    }
+
+    // Ориентиры выбираются "самыми дальними" по числу переходов в неориентированном графе;
+    // недостижимые вершины (другие компоненты) выбираются в первую очередь
+    void SelectLandmarks(int k) {
+        int n = g.VertexCount();
+        if (k <= 0) return;
+        const int UNSEEN = numeric_limits<int>::max();
+        vector<int> hops(n, UNSEEN);
+        vector<int> q(n);
+        int next = 0;
+        for (int i = 0; i < k; i++) {
+            landmarks.push_back(next);
+            size_t head = 0, tail = 0;
+            vector<int> local(n, UNSEEN);
+            local[next] = 0;
+            q[tail++] = next;
+            while (head < tail) {
+                int u = q[head++];
+                auto visit = [&](int v) {
+                    if (local[v] == UNSEEN) { local[v] = local[u] + 1; q[tail++] = v; }
+                };
+                for (int e = g.outStart[u]; e < g.outStart[u + 1]; e++) visit(g.edgeTo[e]);
+                for (int j = g.inStart[u]; j < g.inStart[u + 1]; j++) visit(g.edgeFrom[g.inEdge[j]]);
+            }
+            for (int v = 0; v < n; v++) hops[v] = min(hops[v], local[v]);
+
+            int farthest = -1;
+            for (int v = 0; v < n; v++) {
+                if (hops[v] > 0 && (farthest == -1 || hops[v] > hops[farthest])) farthest = v;
+            }
+            if (farthest == -1) break; // все вершины уже ориентиры
+            next = farthest;
+        }
+    }
+
+    // Расстояния от root до всех вершин (reverse = true: от всех вершин до root)
+    void FullDistances(int root, bool reverseEdges, double* out) {
+        int n = g.VertexCount();
+        fill(out, out + n, numeric_limits<double>::infinity());
+        auto cmp = greater<pair<double, int>>();
+        vector<pair<double, int>> pq;
+        out[root] = 0;
+        pq.push_back({0, root});
+        while (!pq.empty()) {
+            pop_heap(pq.begin(), pq.end(), cmp);
+            double d = pq.back().first;
+            int u = pq.back().second;
+            pq.pop_back();
+            if (d > out[u]) continue;
+            int from = reverseEdges ? g.inStart[u] : g.outStart[u];
+            int to = reverseEdges ? g.inStart[u + 1] : g.outStart[u + 1];
+            for (int i = from; i < to; i++) {
+                int e = reverseEdges ? g.inEdge[i] : i;
+                if (g.edgeRepair[e]) continue;
+                int v = reverseEdges ? g.edgeFrom[e] : g.edgeTo[e];
+                if (d + g.edgeLength[e] < out[v]) {
+                    out[v] = d + g.edgeLength[e];
+                    pq.push_back({out[v], v});
+                    push_heap(pq.begin(), pq.end(), cmp);
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef SNAPSHOT_ANALYZER_H
+#define SNAPSHOT_ANALYZER_H
+
+#include "snapshot_view.h"
+#include "network_manager.h"
+#include <vector>
+#include <memory>
+#include <iostream>
+
+using namespace std;
+
+// Запросы только для чтения поверх отображенного снимка: вывод сети, кратчайший путь,
+// максимальный поток и поиск. Граф строится прямо из записей снимка при первом запросе.
+class SnapshotAnalyzer {
+private:
+    const SnapshotView& view;
+    NetworkGraph graph;
+    bool graphBuilt = false;
+
+    PathEngines engines;
+
+public:
+    explicit SnapshotAnalyzer(const SnapshotView& snapshot) : view(snapshot) {}
+
+    const NetworkGraph& GetGraph() {
+        if (!graphBuilt) {
+            graph.Build(view.Pipes(), [](const PipeRecord& p) { return NetworkManager::CalculateCapacity(p); });
+            graphBuilt = true;
+        }
+        return graph;
+    }
+
+    // --- ОТОБРАЖЕНИЕ ---
+    void DisplayNetwork() const { NetworkManager::PrintNetwork(view.Pipes()); }
+
+    // --- КРАТЧАЙШИЙ ПУТЬ ---
+    ShortestPathResult ComputeShortestPath(int startId, int endId, PathAlgorithm algorithm = PathAlgorithm::Dijkstra) {
+        const NetworkGraph& g = GetGraph();
+        return engines.ShortestPath(g, startId, endId, algorithm,
+            [this](int id) { return view.FindStation(id) != nullptr; },
+            [this, &g]() -> ContractionHierarchy& {
+                if (!engines.hierarchy) {
+                    engines.hierarchy.reset(new ContractionHierarchy());
+                    engines.hierarchy->Build(g);
+                }
+                return *engines.hierarchy;
+            });
+    }
+
+    void FindShortestPath(int startId, int endId, PathAlgorithm algorithm = PathAlgorithm::Dijkstra) {
+        ShortestPathResult result = ComputeShortestPath(startId, endId, algorithm);
+        NetworkManager::PrintShortestPath(result, startId, endId, GetGraph());
+    }
+
+    // --- МАКСИМАЛЬНЫЙ ПОТОК ---
+    MaxFlowResult ComputeMaxFlow(int source, int sink, MaxFlowAlgorithm algorithm = MaxFlowAlgorithm::Dinic) {
+        return PathEngines::MaxFlow(GetGraph(), source, sink, algorithm);
+    }
+
+    void CalculateMaxFlow(int source, int sink, MaxFlowAlgorithm algorithm = MaxFlowAlgorithm::Dinic) {
+        MaxFlowResult result = ComputeMaxFlow(source, sink, algorithm);
+        NetworkManager::PrintMaxFlow(result, source, sink, GetGraph());
+    }
+
+    // --- ПОИСК (результат - указатели на записи внутри отображения) ---
+    vector<const PipeRecord*> SearchPipesByKmMark(string_view kmMark) const {
+        vector<const PipeRecord*> results;
+        for (const auto& pipe : view.Pipes()) {
+            if (view.KmMark(pipe).find(kmMark) != string_view::npos) results.push_back(&pipe);
+        }
+        return results;
+    }
+
+    vector<const PipeRecord*> SearchPipesByDiameter(int diameter) const {
+        vector<const PipeRecord*> results;
+        for (const auto& pipe : view.Pipes()) {
+            if (pipe.diametr == diameter) results.push_back(&pipe);
+        }
+        return results;
+    }
+
+    vector<const PipeRecord*> SearchPipesByRepair(bool repair) const {
+        vector<const PipeRecord*> results;
+        for (const auto& pipe : view.Pipes()) {
+            if ((pipe.repair != 0) == repair) results.push_back(&pipe);
+        }
+        return results;
+    }
+
+    vector<const CompressRecord*> SearchCompressByName(string_view name) const {
+        vector<const CompressRecord*> results;
+        for (const auto& station : view.Stations()) {
+            if (view.Name(station).find(name) != string_view::npos) results.push_back(&station);
+        }
+        return results;
+    }
+
+    vector<const CompressRecord*> SearchCompressByClassification(string_view classification) const {
+        vector<const CompressRecord*> results;
+        for (const auto& station : view.Stations()) {
+            if (view.Classification(station).find(classification) != string_view::npos) results.push_back(&station);
+        }
+        return results;
+    }
+
+    void PrintPipes(const vector<const PipeRecord*>& pipes) const {
+        for (const PipeRecord* p : pipes) {
+            cout << "ID:" << p->id << " Km:" << view.KmMark(*p) << " L:" << p->length
+                 << " D:" << p->diametr << (p->repair ? " [REPAIR]" : "") << "\n";
+        }
+        cout << "Found: " << pipes.size() << "\n";
+    }
+
+    void PrintStations(const vector<const CompressRecord*>& stations) const {
+        for (const CompressRecord* c : stations) {
+            cout << "ID:" << c->id << " " << view.Name(*c) << " (" << view.Classification(*c) << ")"
+                 << " Workshops: " << c->workshop_working << "/" << c->workshop_count << "\n";
+        }
+        cout << "Found: " << stations.size() << "\n";
+    }
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef SNAPSHOT_FORMAT_H
+#define SNAPSHOT_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+// Двоичный снимок данных (версия 1).
+// Раскладка файла:
+//   SnapshotHeader | PipeRecord[pipeCount] | CompressRecord[compressCount] | пул строк
+// Все таблицы выровнены на 8 байт, числа хранятся в порядке байт машины (little-endian).
+// Строки (km_mark, name, classification) лежат в общем пуле и задаются смещением и длиной.
+
+static const char SNAPSHOT_MAGIC[8] = {'G', 'A', 'S', 'N', 'E', 'T', 'S', 'N'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotString {
+    uint32_t offset;   // смещение в пуле строк
+    uint32_t length;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t pipeRecordSize;
+    uint32_t compressRecordSize;
+    uint64_t pipeCount;
+    uint64_t compressCount;
+    uint64_t pipeOffset;
+    uint64_t compressOffset;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+    int32_t nextPipeId;
+    int32_t nextCompressId;
+};
+
+struct PipeRecord {
+    int32_t id;
+    int32_t diametr;
+    double length;
+    int32_t source_cs_id;
+    int32_t dest_cs_id;
+    SnapshotString km_mark;
+    uint8_t repair;
+    uint8_t reserved[7];
+};
+
+struct CompressRecord {
+    int32_t id;
+    int32_t workshop_count;
+    int32_t workshop_working;
+    uint8_t working;
+    uint8_t reserved[3];
+    SnapshotString name;
+    SnapshotString classification;
+};
+
+static_assert(sizeof(SnapshotHeader) == 80, "snapshot header layout changed");
+static_assert(sizeof(PipeRecord) == 40, "pipe record layout changed");
+static_assert(sizeof(CompressRecord) == 32, "compress record layout changed");
+
+inline bool IsSnapshotMagic(const char* data, size_t size) {
+    return size >= sizeof(SNAPSHOT_MAGIC) && memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+inline uint64_t AlignSnapshot(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+// Проверка заголовка и границ всех таблиц относительно размера файла
+inline bool ValidateSnapshotHeader(const SnapshotHeader& h, uint64_t fileSize, string& error) {
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) { error = "not a snapshot file"; return false; }
+    if (h.version != SNAPSHOT_VERSION) { error = "unsupported snapshot version " + to_string(h.version); return false; }
+    if (h.headerSize != sizeof(SnapshotHeader) || h.pipeRecordSize != sizeof(PipeRecord) ||
+        h.compressRecordSize != sizeof(CompressRecord)) {
+        error = "snapshot record layout mismatch";
+        return false;
+    }
+    auto fits = [fileSize](uint64_t offset, uint64_t count, uint64_t size) {
+        return offset <= fileSize && (size == 0 || count <= (fileSize - offset) / size);
+    };
+    if (!fits(h.pipeOffset, h.pipeCount, sizeof(PipeRecord)) ||
+        !fits(h.compressOffset, h.compressCount, sizeof(CompressRecord)) ||
+        !fits(h.stringOffset, h.stringSize, 1) ||
+        h.pipeOffset % 8 != 0 || h.compressOffset % 8 != 0) {
+        error = "snapshot is truncated";
+        return false;
+    }
+    return true;
+}
+
+inline bool SnapshotStringValid(const SnapshotString& s, uint64_t poolSize) {
+    return (uint64_t)s.offset + s.length <= poolSize;
+}
+
+#endif
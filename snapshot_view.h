@@ -0,0 +1,118 @@
+#ifndef SNAPSHOT_VIEW_H
+#define SNAPSHOT_VIEW_H
+
+#include "snapshot_format.h"
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Непрерывный диапазон записей внутри отображения (для range-for и NetworkGraph::Build)
+template<typename Record>
+struct RecordRange {
+    const Record* first = nullptr;
+    size_t count = 0;
+
+    const Record* begin() const { return first; }
+    const Record* end() const { return first + count; }
+    size_t size() const { return count; }
+    const Record& operator[](size_t i) const { return first[i]; }
+};
+
+// Двоичный снимок, отображенный в память только для чтения.
+// Записи не копируются: запросы читают страницы файла напрямую, строки отдаются
+// как string_view в пул строк. Открытие проверяет только заголовок, поэтому
+// не зависит от размера файла; страницы подгружаются по мере обращения.
+class SnapshotView {
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    SnapshotHeader header = {};
+    string error;
+
+public:
+    SnapshotView() = default;
+    SnapshotView(const SnapshotView&) = delete;
+    SnapshotView& operator=(const SnapshotView&) = delete;
+
+    ~SnapshotView() { Close(); }
+
+    bool Open(const string& filename) {
+        Close();
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            error = "file not found";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader)) {
+            ::close(fd);
+            error = "not a snapshot file";
+            return false;
+        }
+
+        // MAP_SHARED: страницы общие с кэшем ОС и другими процессами, открывшими тот же снимок
+        void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            error = "mmap failed";
+            return false;
+        }
+        data = (const char*)mapped;
+        size = (size_t)st.st_size;
+
+        memcpy(&header, data, sizeof(header));
+        if (!ValidateSnapshotHeader(header, size, error)) {
+            Close();
+            return false;
+        }
+        error.clear();
+        return true;
+    }
+
+    void Close() {
+        if (data) munmap((void*)data, size);
+        data = nullptr;
+        size = 0;
+        header = {};
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+    const string& Error() const { return error; }
+    size_t FileSize() const { return size; }
+
+    RecordRange<PipeRecord> Pipes() const {
+        return {(const PipeRecord*)(data + header.pipeOffset), (size_t)header.pipeCount};
+    }
+
+    RecordRange<CompressRecord> Stations() const {
+        return {(const CompressRecord*)(data + header.compressOffset), (size_t)header.compressCount};
+    }
+
+    // Ссылка за пределы пула дает пустую строку (записи проверяются при чтении, а не при открытии)
+    string_view String(const SnapshotString& s) const {
+        if (!SnapshotStringValid(s, header.stringSize)) return string_view();
+        return string_view(data + header.stringOffset + s.offset, s.length);
+    }
+
+    string_view KmMark(const PipeRecord& pipe) const { return String(pipe.km_mark); }
+    string_view Name(const CompressRecord& station) const { return String(station.name); }
+    string_view Classification(const CompressRecord& station) const { return String(station.classification); }
+
+    // Поиск по id - линейный проход (индекс не строится, чтобы открытие оставалось мгновенным)
+    const PipeRecord* FindPipe(int id) const {
+        for (const auto& pipe : Pipes()) if (pipe.id == id) return &pipe;
+        return nullptr;
+    }
+
+    const CompressRecord* FindStation(int id) const {
+        for (const auto& station : Stations()) if (station.id == id) return &station;
+        return nullptr;
+    }
+};
+
+#endif
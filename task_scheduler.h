@@ -0,0 +1,305 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <string>
+
+using namespace std;
+
+// Планировщик задач с перехватом работы (work stealing), общий для движков.
+// У каждого рабочего своя очередь: новые задачи рабочий кладет и берет с конца (LIFO,
+// горячий кэш), простаивающие рабочие забирают задачи с начала чужих очередей.
+// Ожидающий (TaskGroup::Wait, ParallelFor) сам выполняет задачи из очередей, поэтому вложенный
+// fork-join не занимает потоки впустую и не зависает; когда свободных задач нет, он спит,
+// пока не завершатся задачи группы, выполняемые другими потоками.
+class TaskScheduler {
+public:
+    // Хук замера: метка задачи, время выполнения, номер рабочего (-1 - вызывающий поток)
+    using TimingHook = function<void(const char* label, chrono::nanoseconds elapsed, int worker)>;
+
+    // Группа задач fork-join: Run добавляет задачу, Wait дожидается всех.
+    // Исключение задачи не теряется: Wait после завершения всех задач бросает первое из них.
+    class TaskGroup {
+    private:
+        TaskScheduler& scheduler;
+        atomic<size_t> pending{0};
+
+        mutex doneLock;                // счетчик уменьшается под ним, чтобы не потерять пробуждение
+        condition_variable done;
+        exception_ptr failure;         // первое исключение задач, под doneLock
+
+    public:
+        explicit TaskGroup(TaskScheduler& owner) : scheduler(owner) {}
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+        ~TaskGroup() { WaitAll(); }   // деструктор не бросает: исключение забирает Wait
+
+        template<typename F>
+        void Run(F task, const char* label = "task") {
+            pending.fetch_add(1, memory_order_relaxed);
+            scheduler.Push(Task{[this, task = move(task)]() mutable {
+                exception_ptr error;
+                try {
+                    task();
+                } catch (...) {
+                    error = current_exception();
+                }
+                // После разблокировки группа может быть уже уничтожена ожидающим
+                lock_guard<mutex> guard(doneLock);
+                if (error && !failure) failure = error;
+                if (pending.fetch_sub(1, memory_order_acq_rel) == 1) done.notify_all();
+            }, label});
+        }
+
+        void Wait() {
+            WaitAll();
+            exception_ptr error;
+            {
+                lock_guard<mutex> guard(doneLock);
+                swap(error, failure);
+            }
+            if (error) rethrow_exception(error);
+        }
+
+    private:
+        void WaitAll() {
+            while (pending.load(memory_order_acquire) != 0) {
+                if (scheduler.RunOne()) continue;
+                // Свободных задач нет: оставшиеся задачи группы уже выполняются другими потоками
+                unique_lock<mutex> guard(doneLock);
+                done.wait(guard, [this]() { return pending.load(memory_order_acquire) == 0; });
+            }
+            // Последняя задача уменьшает счетчик под мьютексом: дожидаемся, пока она его отпустит
+            lock_guard<mutex> guard(doneLock);
+        }
+    };
+
+private:
+    struct Task {
+        function<void()> run;
+        const char* label = "task";
+    };
+
+    struct Queue {
+        mutex lock;
+        deque<Task> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> threads;
+    atomic<size_t> queued{0};
+    atomic<size_t> nextInject{0};
+    atomic<bool> stopping{false};
+
+    mutex sleepLock;
+    condition_variable wake;
+
+    shared_ptr<const TimingHook> hook;   // доступ через atomic_load/atomic_store
+
+    // Рабочий поток знает свой планировщик и номер; для остальных потоков номер -1
+    struct WorkerIdentity {
+        const TaskScheduler* owner = nullptr;
+        int index = -1;
+    };
+
+    static WorkerIdentity& Identity() {
+        thread_local WorkerIdentity identity;
+        return identity;
+    }
+
+    int CurrentWorker() const {
+        const WorkerIdentity& identity = Identity();
+        return identity.owner == this ? identity.index : -1;
+    }
+
+public:
+    explicit TaskScheduler(int threadCount = 0) {
+        if (threadCount <= 0) threadCount = (int)max(1u, thread::hardware_concurrency());
+        for (int i = 0; i < threadCount; i++) queues.emplace_back(new Queue());
+        for (int i = 0; i < threadCount; i++) threads.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    ~TaskScheduler() {
+        {
+            lock_guard<mutex> guard(sleepLock);
+            stopping.store(true);
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    // Общий планировщик по числу ядер
+    static TaskScheduler& Shared() {
+        static TaskScheduler instance;
+        return instance;
+    }
+
+    int WorkerCount() const { return (int)threads.size(); }
+
+    // Хук вызывается после каждой задачи и участка ParallelFor на выполнившем их потоке;
+    // пустой хук отключает замер
+    void SetTimingHook(TimingHook timing) {
+        atomic_store(&hook, timing ? make_shared<const TimingHook>(move(timing)) : shared_ptr<const TimingHook>());
+    }
+
+    // Параллельный цикл по [begin, end): body(lo, hi) получает непрерывные участки не больше grain.
+    // Диапазон делится пополам рекурсивно, вызывающий поток участвует в работе.
+    // Исключение из body передается вызывающему после завершения остальных участков.
+    template<typename Body>
+    void ParallelFor(size_t begin, size_t end, size_t grain, Body body, const char* label = "parallel-for") {
+        if (begin >= end) return;
+        grain = max<size_t>(grain, 1);
+        if (end - begin <= grain || WorkerCount() == 1) {
+            Timed(label, [&]() { body(begin, end); });
+            return;
+        }
+        TaskGroup group(*this);
+        // Участок, оставшийся вызывающему потоку, замеряется так же, как задачи рабочих
+        Timed(label, [&]() { Split(group, begin, end, grain, body, label); });
+        group.Wait();
+    }
+
+    // Размер участка, чтобы на каждого рабочего пришлось около chunksPerWorker участков
+    size_t GrainFor(size_t count, size_t chunksPerWorker = 4, size_t minGrain = 1) const {
+        size_t chunks = (size_t)WorkerCount() * chunksPerWorker;
+        return max(minGrain, (count + chunks - 1) / chunks);
+    }
+
+    // Выполнить одну задачу из очередей, если есть; true, если задача выполнена
+    bool RunOne() {
+        Task task;
+        if (!Take(CurrentWorker(), task)) return false;
+        Timed(task.label, task.run);
+        return true;
+    }
+
+private:
+    template<typename Body>
+    void Split(TaskGroup& group, size_t begin, size_t end, size_t grain, Body& body, const char* label) {
+        while (end - begin > grain) {
+            size_t mid = begin + (end - begin) / 2;
+            group.Run([this, &group, &body, mid, end, grain, label]() { Split(group, mid, end, grain, body, label); }, label);
+            end = mid;
+        }
+        body(begin, end);
+    }
+
+    template<typename F>
+    void Timed(const char* label, F run) {
+        shared_ptr<const TimingHook> timing = atomic_load(&hook);
+        if (!timing) {
+            run();
+            return;
+        }
+        auto started = chrono::steady_clock::now();
+        run();
+        (*timing)(label, chrono::steady_clock::now() - started, CurrentWorker());
+    }
+
+    void Push(Task task) {
+        int self = CurrentWorker();
+        size_t target = self >= 0 ? (size_t)self : nextInject.fetch_add(1, memory_order_relaxed) % queues.size();
+        {
+            lock_guard<mutex> guard(queues[target]->lock);
+            queues[target]->tasks.push_back(move(task));
+        }
+        queued.fetch_add(1, memory_order_release);
+        {
+            lock_guard<mutex> guard(sleepLock);   // не потерять пробуждение между проверкой и wait
+        }
+        wake.notify_one();
+    }
+
+    // Своя очередь - с конца, чужие - с начала
+    bool Take(int self, Task& task) {
+        if (queued.load(memory_order_acquire) == 0) return false;
+        size_t n = queues.size();
+        if (self >= 0) {
+            Queue& own = *queues[self];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = move(own.tasks.back());
+                own.tasks.pop_back();
+                queued.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+        }
+        size_t start = self >= 0 ? (size_t)self + 1 : nextInject.load(memory_order_relaxed);
+        for (size_t k = 0; k < n; k++) {
+            Queue& victim = *queues[(start + k) % n];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(int index) {
+        Identity() = {this, index};
+        Task task;
+        while (true) {
+            if (Take(index, task)) {
+                Timed(task.label, task.run);
+                task.run = nullptr;
+                continue;
+            }
+            unique_lock<mutex> guard(sleepLock);
+            wake.wait(guard, [this]() { return stopping.load() || queued.load(memory_order_acquire) != 0; });
+            if (stopping.load() && queued.load(memory_order_acquire) == 0) return;
+        }
+    }
+};
+
+// Итоги замера по меткам задач: число задач и суммарное время их выполнения на всех потоках.
+// Hook() подключается к одному или нескольким планировщикам; вызовы хука потокобезопасны.
+class TaskTimings {
+public:
+    struct Total {
+        size_t tasks = 0;
+        chrono::nanoseconds elapsed{0};
+    };
+
+private:
+    mutable mutex lock;
+    map<string, Total> totals;
+
+public:
+    TaskScheduler::TimingHook Hook() {
+        return [this](const char* label, chrono::nanoseconds elapsed, int) {
+            lock_guard<mutex> guard(lock);
+            Total& total = totals[label];
+            total.tasks++;
+            total.elapsed += elapsed;
+        };
+    }
+
+    map<string, Total> Totals() const {
+        lock_guard<mutex> guard(lock);
+        return totals;
+    }
+
+    void Clear() {
+        lock_guard<mutex> guard(lock);
+        totals.clear();
+    }
+};
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef TEXT_PARSER_H
+#define TEXT_PARSER_H
+
+#include "structs.h"
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+enum class TextSection { None, Pipes, Stations };
+
+// Участок текста для параллельного разбора: начинается с начала записи,
+// section - секция, действующая в точке begin
+struct TextChunk {
+    size_t begin;
+    size_t end;
+    TextSection section;
+};
+
+// Потоковый разбор текстового формата резервной копии ("Ключ: значение", записи через "~~~").
+// Файл читается блоками фиксированного размера, строки разбираются прямо в буфере,
+// секции переключаются только по заголовкам "===== ... =====".
+// Готовые записи сразу передаются обработчикам; при ошибке разбор останавливается
+// с указанием строки и колонки.
+class TextDataParser {
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    using Section = TextSection;
+
+    Section section = Section::None;
+    Pipe pipe = {};
+    Compress station = {};
+    bool recordOpen = false;    // в текущей записи уже были поля
+    bool recordHasId = false;
+    size_t recordLine = 0;      // строка, с которой началась запись
+
+    size_t lineNumber = 0;
+    size_t bytesRead = 0;
+    size_t errorLine = 0;
+    size_t errorColumn = 0;
+    string error;
+
+public:
+    size_t BytesRead() const { return bytesRead; }
+    size_t LinesRead() const { return lineNumber; }
+    const string& Error() const { return error; }
+
+    // Сообщение вида "line 12, column 15: ..." для вывода пользователю.
+    // lineOffset - число строк перед разобранным участком (для ParseText)
+    string Diagnostic(size_t lineOffset = 0) const {
+        return "line " + to_string(errorLine + lineOffset) + ", column " + to_string(errorColumn) + ": " + error;
+    }
+
+    // Разбор участка текста, уже находящегося в памяти (начинается с начала записи)
+    template<typename PipeSink, typename StationSink>
+    bool ParseText(string_view text, TextSection start, PipeSink onPipe, StationSink onStation) {
+        section = start;
+        ResetRecord();
+        lineNumber = 0;
+        bytesRead = text.size();
+        error.clear();
+
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.find('\n', begin);
+            if (end == string_view::npos) end = text.size();
+            if (!ParseLine(text.substr(begin, end - begin), onPipe, onStation)) return false;
+            begin = end + 1;
+        }
+        return FinishRecord(onPipe, onStation);
+    }
+
+    // Разбиение текста на parts участков по границам записей ("~~~")
+    static vector<TextChunk> SplitIntoChunks(string_view text, size_t parts) {
+        // Заголовки секций: позиция и секция, которая действует после них
+        vector<pair<size_t, Section>> headers;
+        for (size_t pos = 0; pos < text.size();) {
+            size_t end = text.find('\n', pos);
+            if (end == string_view::npos) end = text.size();
+            if (text.compare(pos, 5, "=====") == 0) {
+                string_view line = text.substr(pos, end - pos);
+                if (line.find("PIPES DATA") != string_view::npos) headers.push_back({pos, Section::Pipes});
+                else if (line.find("COMPRESSOR STATIONS DATA") != string_view::npos) headers.push_back({pos, Section::Stations});
+                else if (line.find("DATA BACKUP") != string_view::npos) headers.push_back({pos, Section::None});
+            }
+            pos = text.find("\n=====", end);
+            if (pos == string_view::npos) break;
+            pos++;
+        }
+
+        vector<TextChunk> chunks;
+        size_t begin = 0;
+        for (size_t k = 1; k <= parts && begin < text.size(); k++) {
+            size_t end = text.size();
+            if (k < parts) {
+                size_t target = max(begin, text.size() / parts * k);
+                size_t marker = text.find("\n~~~", target > 0 ? target - 1 : 0);
+                if (marker != string_view::npos) {
+                    size_t lineEnd = text.find('\n', marker + 1);
+                    end = lineEnd == string_view::npos ? text.size() : lineEnd + 1;
+                }
+            }
+            Section current = Section::None;
+            for (const auto& h : headers) if (h.first < begin) current = h.second;
+            chunks.push_back({begin, end, current});
+            begin = end;
+        }
+        return chunks;
+    }
+
+    template<typename PipeSink, typename StationSink>
+    bool Parse(istream& in, PipeSink onPipe, StationSink onStation) {
+        section = Section::None;
+        ResetRecord();
+        lineNumber = 0;
+        bytesRead = 0;
+        error.clear();
+
+        vector<char> buffer(CHUNK_SIZE);
+        size_t filled = 0;
+        bool eof = false;
+        while (!eof) {
+            // Дочитываем блок после перенесенного хвоста незаконченной строки
+            if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+            in.read(buffer.data() + filled, buffer.size() - filled);
+            size_t got = (size_t)in.gcount();
+            bytesRead += got;
+            filled += got;
+            eof = got == 0;
+
+            size_t begin = 0;
+            while (true) {
+                const char* start = buffer.data() + begin;
+                const char* newline = (const char*)memchr(start, '\n', filled - begin);
+                if (!newline) {
+                    if (!eof || begin == filled) break;
+                    newline = buffer.data() + filled; // последняя строка без перевода строки
+                }
+                size_t length = newline - start;
+                if (!ParseLine(string_view(start, length), onPipe, onStation)) return false;
+                begin += length + (newline < buffer.data() + filled ? 1 : 0);
+                if (begin >= filled) break;
+            }
+            filled -= begin;
+            memmove(buffer.data(), buffer.data() + begin, filled);
+        }
+        return FinishRecord(onPipe, onStation);
+    }
+
+private:
+    bool Fail(size_t column, const string& message) {
+        errorLine = lineNumber;
+        errorColumn = column;
+        error = message;
+        return false;
+    }
+
+    void ResetRecord() {
+        pipe = {};
+        station = {};
+        recordOpen = false;
+        recordHasId = false;
+    }
+
+    // Запись заканчивается разделителем, сменой секции или концом файла
+    template<typename PipeSink, typename StationSink>
+    bool FinishRecord(PipeSink& onPipe, StationSink& onStation) {
+        if (!recordOpen) return true;
+        if (!recordHasId) {
+            errorLine = recordLine;
+            errorColumn = 1;
+            error = "record has no ID";
+            return false;
+        }
+        if (section == Section::Pipes) onPipe(pipe);
+        else if (section == Section::Stations) onStation(station);
+        ResetRecord();
+        return true;
+    }
+
+    template<typename PipeSink, typename StationSink>
+    bool ParseLine(string_view line, PipeSink& onPipe, StationSink& onStation) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) return true;
+
+        if (line == "~~~") return FinishRecord(onPipe, onStation);
+
+        // Заголовки секций и линии-разделители
+        if (line.compare(0, 5, "=====") == 0) {
+            if (line.find_first_not_of('=') == string_view::npos) return true;
+            Section next;
+            if (line.find("PIPES DATA") != string_view::npos) next = Section::Pipes;
+            else if (line.find("COMPRESSOR STATIONS DATA") != string_view::npos) next = Section::Stations;
+            else if (line.find("DATA BACKUP") != string_view::npos) next = Section::None;
+            else return Fail(1, "unknown section header");
+            if (!FinishRecord(onPipe, onStation)) return false;
+            section = next;
+            return true;
+        }
+        if (line.find_first_not_of('-') == string_view::npos) return true;
+
+        size_t colon = line.find(':');
+        if (colon == string_view::npos) return Fail(1, "expected 'Key: value'");
+        string_view key = line.substr(0, colon);
+        size_t valueColumn = colon + 1;
+        if (valueColumn < line.size() && line[valueColumn] == ' ') valueColumn++;
+        string_view value = line.substr(valueColumn);
+        valueColumn++; // колонки считаются с 1
+
+        // Служебные строки заголовка файла и секций
+        if (!recordOpen && (key == "Backup time" || key == "Total pipes" || key == "Total stations")) return true;
+
+        if (section == Section::None) return Fail(1, "field outside of a section");
+        if (!recordOpen) {
+            recordOpen = true;
+            recordLine = lineNumber;
+        }
+        return section == Section::Pipes ? ParsePipeField(key, value, valueColumn)
+                                         : ParseStationField(key, value, valueColumn);
+    }
+
+    bool ParsePipeField(string_view key, string_view value, size_t column) {
+        if (key == "ID") { recordHasId = true; return ParseInt(value, column, pipe.id); }
+        if (key == "KM Mark") { pipe.km_mark.assign(value.data(), value.size()); return true; }
+        if (key == "Length (km)") return ParseDouble(value, column, pipe.length);
+        if (key == "Diameter (mm)") return ParseInt(value, column, pipe.diametr);
+        if (key == "On repair") return ParseYesNo(value, column, pipe.repair);
+        if (key == "From CS") return ParseInt(value, column, pipe.source_cs_id);
+        if (key == "To CS") return ParseInt(value, column, pipe.dest_cs_id);
+        return Fail(1, "unknown pipe field '" + string(key) + "'");
+    }
+
+    bool ParseStationField(string_view key, string_view value, size_t column) {
+        if (key == "ID") { recordHasId = true; return ParseInt(value, column, station.id); }
+        if (key == "Name") { station.name.assign(value.data(), value.size()); return true; }
+        if (key == "Workshops") return ParseInt(value, column, station.workshop_count);
+        if (key == "Working") return ParseInt(value, column, station.workshop_working);
+        if (key == "Classification") { station.classification.assign(value.data(), value.size()); return true; }
+        if (key == "Active") return ParseYesNo(value, column, station.working);
+        return Fail(1, "unknown station field '" + string(key) + "'");
+    }
+
+    bool ParseInt(string_view value, size_t column, int& out) {
+        auto [end, ec] = from_chars(value.data(), value.data() + value.size(), out);
+        if (ec != errc() || value.empty()) return Fail(column, "expected an integer");
+        if (end != value.data() + value.size()) return Fail(column + (end - value.data()), "unexpected characters after number");
+        return true;
+    }
+
+    bool ParseDouble(string_view value, size_t column, double& out) {
+        auto [end, ec] = from_chars(value.data(), value.data() + value.size(), out);
+        if (ec != errc() || value.empty()) return Fail(column, "expected a number");
+        if (end != value.data() + value.size()) return Fail(column + (end - value.data()), "unexpected characters after number");
+        return true;
+    }
+
+    bool ParseYesNo(string_view value, size_t column, bool& out) {
+        if (value == "Yes") out = true;
+        else if (value == "No") out = false;
+        else return Fail(column, "expected 'Yes' or 'No'");
+        return true;
+    }
+};
+
+#endif
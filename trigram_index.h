@@ -0,0 +1,143 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// Инвертированный индекс по триграммам текстового поля: триграмма -> отсортированный массив id.
+// Для запроса из MinQuery и более символов дает кандидатов - id, текст которых содержит
+// все триграммы запроса. Это надмножество точных совпадений, их проверяет вызывающий.
+class TrigramIndex {
+private:
+    unordered_map<uint32_t, vector<int>> postings;
+
+    static uint32_t Gram(string_view text, size_t i) {
+        return (uint32_t)(unsigned char)text[i] << 16 | (uint32_t)(unsigned char)text[i + 1] << 8 |
+               (uint32_t)(unsigned char)text[i + 2];
+    }
+
+    // Различные триграммы текста
+    static vector<uint32_t> Grams(string_view text) {
+        vector<uint32_t> grams;
+        if (text.size() < MinQuery) return grams;
+        grams.reserve(text.size() - 2);
+        for (size_t i = 0; i + 2 < text.size(); i++) grams.push_back(Gram(text, i));
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+    // Пересечение отсортированных списков; короткий список ищется в длинном двоичным поиском
+    static void Intersect(vector<int>& current, const vector<int>& list) {
+        size_t kept = 0;
+        if (current.size() * 16 < list.size()) {
+            auto from = list.begin();
+            for (int id : current) {
+                from = lower_bound(from, list.end(), id);
+                if (from == list.end()) break;
+                if (*from == id) current[kept++] = id;
+            }
+        } else {
+            size_t j = 0;
+            for (int id : current) {
+                while (j < list.size() && list[j] < id) j++;
+                if (j == list.size()) break;
+                if (list[j] == id) current[kept++] = id;
+            }
+        }
+        current.resize(kept);
+    }
+
+public:
+    static constexpr size_t MinQuery = 3;
+
+    void Insert(string_view text, int id) {
+        for (uint32_t gram : Grams(text)) {
+            vector<int>& list = postings[gram];
+            // id обычно выдаются по возрастанию, поэтому чаще всего это добавление в конец
+            if (list.empty() || list.back() < id) list.push_back(id);
+            else {
+                auto it = lower_bound(list.begin(), list.end(), id);
+                if (*it != id) list.insert(it, id);
+            }
+        }
+    }
+
+    void Erase(string_view text, int id) {
+        for (uint32_t gram : Grams(text)) {
+            auto found = postings.find(gram);
+            if (found == postings.end()) continue;
+            vector<int>& list = found->second;
+            auto it = lower_bound(list.begin(), list.end(), id);
+            if (it != list.end() && *it == id) list.erase(it);
+            if (list.empty()) postings.erase(found);
+        }
+    }
+
+    void Update(string_view before, string_view after, int id) {
+        if (before == after) return;
+        Erase(before, id);
+        Insert(after, id);
+    }
+
+    // Кандидаты по возрастанию id; false, если запрос короче MinQuery и индекс не применим
+    bool Candidates(string_view query, vector<int>& out) const {
+        out.clear();
+        if (query.size() < MinQuery) return false;
+
+        vector<const vector<int>*> lists;
+        for (uint32_t gram : Grams(query)) {
+            auto found = postings.find(gram);
+            if (found == postings.end()) return true;
+            lists.push_back(&found->second);
+        }
+        sort(lists.begin(), lists.end(), [](const vector<int>* a, const vector<int>* b) { return a->size() < b->size(); });
+
+        out = *lists[0];
+        for (size_t k = 1; k < lists.size() && !out.empty(); k++) Intersect(out, *lists[k]);
+        return true;
+    }
+
+    // Верхняя оценка числа совпадений - длина самого короткого списка; SIZE_MAX, если индекс не применим
+    size_t Estimate(string_view query) const {
+        if (query.size() < MinQuery) return SIZE_MAX;
+        size_t best = SIZE_MAX;
+        for (uint32_t gram : Grams(query)) {
+            auto found = postings.find(gram);
+            if (found == postings.end()) return 0;
+            best = min(best, found->second.size());
+        }
+        return best;
+    }
+
+    size_t GramCount() const { return postings.size(); }
+
+    void Clear() { postings.clear(); }
+};
+
+// Порядок выдачи подстрочного поиска: полное совпадение, затем совпадение с начала,
+// затем более раннее вхождение, более короткий текст и меньший id
+struct SubstringRank {
+    size_t position;
+    size_t length;
+    int id;
+
+    bool operator<(const SubstringRank& other) const {
+        if (position != other.position) return position < other.position;
+        if (length != other.length) return length < other.length;
+        return id < other.id;
+    }
+
+    // Добавляет ранг, если query входит в text
+    static void Match(vector<SubstringRank>& ranks, string_view text, string_view query, int id) {
+        size_t position = text.find(query);
+        if (position != string_view::npos) ranks.push_back({position, text.size(), id});
+    }
+};
+
+#endif
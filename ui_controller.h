@@ -5,11 +5,14 @@
 #include "compress_manager.h"
 #include "file_manager.h"
 #include "search_engine.h"
+#include "query_planner.h"
 #include "network_manager.h"
+#include "snapshot_analyzer.h"
 #include <iostream>
 #include <limits>
 #include <iomanip>
-#include <set>
+#include <chrono>
+#include <algorithm>
 
 using namespace std;
 
@@ -20,15 +23,13 @@ private:
     Logger& logger;
     FileManager& fileManager;
     SearchEngine searchEngine;
+    QueryPlanner queryPlanner;
     NetworkManager networkManager;
 
-    // Список допустимых диаметров
-    const set<int> ALLOWED_DIAMETERS = {500, 700, 1000, 1400};
-
 public:
     UIController(PipeManager& pm, CompressManager& cm, Logger& log, FileManager& fm)
         : pipeManager(pm), compressManager(cm), logger(log), fileManager(fm), 
-          searchEngine(log), networkManager(pm, cm) {}
+          searchEngine(log), queryPlanner(searchEngine, log), networkManager(pm, cm) {}
 
     // --- ОБНОВЛЕННЫЙ МЕТОД: AddPipe (с проверкой диаметров) ---
     void AddPipe() {
@@ -48,7 +49,7 @@ public:
             if (cin.fail()) {
                 cin.clear(); cin.ignore(10000, '\n'); cout << "Invalid input.\n"; continue;
             }
-            if (ALLOWED_DIAMETERS.count(pipe.diametr)) {
+            if (PipeManager::IsAllowedDiameter(pipe.diametr)) {
                 break;
             } else {
                 cout << "Error: Diameter not allowed.\n";
@@ -57,7 +58,7 @@ public:
 
         cout << "On repair? (0 - no, 1 - yes): "; cin >> pipe.repair;
 
-        pipeManager.Add(pipe);
+        pipeManager.Emplace(move(pipe));
         cout << "Pipe added successfully!\n";
         logger.Log("ADDED PIPE manually");
     }
@@ -65,7 +66,7 @@ public:
     // Метод для создания трубы при соединении (тоже с валидацией, но диаметр уже передан)
     int AddPipeInteractive(int fixedDiameter) {
         // Проверка на всякий случай, если вызов будет программным
-        if (ALLOWED_DIAMETERS.find(fixedDiameter) == ALLOWED_DIAMETERS.end()) {
+        if (!PipeManager::IsAllowedDiameter(fixedDiameter)) {
              cout << "Error: Invalid diameter passed to interactive creation.\n";
              return -1;
         }
@@ -83,8 +84,7 @@ public:
 
         cout << "On repair? (0/1): "; cin >> pipe.repair;
 
-        pipeManager.Add(pipe);
-        return pipeManager.GetAll().back().id;
+        return pipeManager.Emplace(move(pipe)).id;
     }
 
     // --- МЕТОДЫ ДЛЯ СЕТИ ---
@@ -103,7 +103,7 @@ public:
         while (true) {
             cout << "Enter Pipe Diameter (500, 700, 1000, 1400): ";
             cin >> diameter;
-            if (ALLOWED_DIAMETERS.count(diameter)) break;
+            if (PipeManager::IsAllowedDiameter(diameter)) break;
             cout << "Invalid diameter.\n"; cin.clear(); cin.ignore(10000, '\n');
         }
 
@@ -128,7 +128,12 @@ public:
         int start, end;
         cout << "Enter Start CS ID: "; cin >> start;
         cout << "Enter End CS ID: "; cin >> end;
-        networkManager.FindShortestPath(start, end);
+        int mode;
+        cout << "Mode (1 - Dijkstra, 2 - Bidirectional, 3 - A* with landmarks, 4 - Contraction hierarchy): "; cin >> mode;
+        PathAlgorithm algorithm = mode == 2 ? PathAlgorithm::Bidirectional
+                                : mode == 3 ? PathAlgorithm::ALT
+                                : mode == 4 ? PathAlgorithm::ContractionHierarchy : PathAlgorithm::Dijkstra;
+        networkManager.FindShortestPath(start, end, algorithm);
     }
 
     void CalculateFlow() {
@@ -136,7 +141,118 @@ public:
         int start, end;
         cout << "Enter Source CS ID: "; cin >> start;
         cout << "Enter Sink CS ID: "; cin >> end;
-        networkManager.CalculateMaxFlow(start, end);
+        int algo;
+        cout << "Algorithm (1 - Dinic, 2 - Push-relabel): "; cin >> algo;
+        networkManager.CalculateMaxFlow(start, end, algo == 2 ? MaxFlowAlgorithm::PushRelabel : MaxFlowAlgorithm::Dinic);
+    }
+
+    // Матрица расстояний между всеми КС
+    void CalculateDistanceMatrix() {
+        vector<int> ids;
+        for (const auto& c : compressManager.GetAll()) ids.push_back(c.id);
+        sort(ids.begin(), ids.end());
+        if (ids.empty()) { cout << "No CS.\n"; return; }
+
+        DistanceMatrix matrix = networkManager.ComputeDistanceMatrix(ids);
+        cout << "\n===== Distance Matrix (km) =====\n";
+        if (ids.size() > 20) {
+            size_t reachable = 0;
+            for (double d : matrix.distance) if (d != numeric_limits<double>::infinity()) reachable++;
+            cout << ids.size() << "x" << ids.size() << " matrix computed, reachable pairs: " << reachable << "\n";
+            return;
+        }
+        cout << setw(8) << "from\\to";
+        for (int id : ids) cout << setw(9) << id;
+        cout << "\n";
+        for (size_t i = 0; i < ids.size(); i++) {
+            cout << setw(8) << ids[i];
+            for (size_t j = 0; j < ids.size(); j++) {
+                double d = matrix.At(i, j);
+                if (d == numeric_limits<double>::infinity()) cout << setw(9) << "-";
+                else cout << setw(9) << fixed << setprecision(1) << d << defaultfloat;
+            }
+            cout << "\n";
+        }
+    }
+
+    // Замер масштабирования расчета матрицы расстояний по числу потоков
+    void BenchmarkDistanceMatrix() {
+        vector<int> ids;
+        for (const auto& c : compressManager.GetAll()) ids.push_back(c.id);
+        if (ids.empty()) { cout << "No CS.\n"; return; }
+
+        vector<int> counts = NetworkManager::BenchmarkThreadCounts();
+        vector<double> times = networkManager.BenchmarkDistanceMatrix(ids, counts);
+        cout << "\n===== Distance Matrix Scaling (" << ids.size() << " sources) =====\n";
+        cout << setw(8) << "Threads" << setw(12) << "Time (ms)" << setw(10) << "Speedup" << "\n";
+        for (size_t i = 0; i < counts.size(); i++) {
+            double ms = times[i];
+            cout << setw(8) << counts[i] << setw(12) << fixed << setprecision(2) << ms
+                 << setw(9) << setprecision(2) << (ms > 0 ? times[0] / ms : 0.0) << "x" << defaultfloat << "\n";
+        }
+        logger.Log("BENCHMARK distance matrix - sources: " + to_string(ids.size()));
+    }
+
+    // Предобработка сети для быстрых запросов маршрута
+    void PrepareRoutes() {
+        auto started = chrono::steady_clock::now();
+        const ContractionHierarchy& ch = networkManager.PrepareContractionHierarchy();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        if (!ch.Ready()) {
+            cout << "Contraction hierarchy not built: the network needs more than " << ch.ShortcutBudget()
+                 << " shortcuts (" << ms << " ms). Mode 4 route queries use bidirectional search.\n";
+            logger.Log("PREPARED contraction hierarchy - over shortcut budget");
+            return;
+        }
+        cout << "Contraction hierarchy ready: " << ch.ShortcutCount() << " edges, " << ms << " ms\n";
+        logger.Log("PREPARED contraction hierarchy");
+    }
+
+    // Анализ двоичного снимка без загрузки: запросы читают отображенный файл
+    void AnalyzeSnapshot() {
+        string filename;
+        cout << "Snapshot file: "; cin >> filename;
+        auto started = chrono::steady_clock::now();
+        SnapshotView view;
+        if (!view.Open(filename)) {
+            cout << "Error: " << view.Error() << "\n";
+            return;
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        cout << "Mapped " << view.Pipes().size() << " pipes, " << view.Stations().size()
+             << " stations (" << view.FileSize() << " bytes) in " << ms << " ms\n";
+        logger.Log("OPENED SNAPSHOT " + filename);
+
+        SnapshotAnalyzer analyzer(view);
+        while (true) {
+            cout << "\n--- Snapshot (read-only) ---\n";
+            cout << "1. View Network Topology\n2. Shortest Path\n3. Max Flow\n";
+            cout << "4. Search pipes by KM mark\n5. Search CS by name\n0. Back\nChoose: ";
+            int choice;
+            if (!(cin >> choice)) { cin.clear(); cin.ignore(numeric_limits<streamsize>::max(), '\n'); continue; }
+            if (choice == 0) break;
+            if (choice == 1) analyzer.DisplayNetwork();
+            else if (choice == 2 || choice == 3) {
+                int start, end, mode;
+                cout << "Enter Start CS ID: "; cin >> start;
+                cout << "Enter End CS ID: "; cin >> end;
+                if (choice == 2) {
+                    cout << "Mode (1 - Dijkstra, 2 - Bidirectional, 3 - A* with landmarks, 4 - Contraction hierarchy): "; cin >> mode;
+                    PathAlgorithm algorithm = mode == 2 ? PathAlgorithm::Bidirectional
+                                            : mode == 3 ? PathAlgorithm::ALT
+                                            : mode == 4 ? PathAlgorithm::ContractionHierarchy : PathAlgorithm::Dijkstra;
+                    analyzer.FindShortestPath(start, end, algorithm);
+                } else {
+                    cout << "Algorithm (1 - Dinic, 2 - Push-relabel): "; cin >> mode;
+                    analyzer.CalculateMaxFlow(start, end, mode == 2 ? MaxFlowAlgorithm::PushRelabel : MaxFlowAlgorithm::Dinic);
+                }
+            } else if (choice == 4 || choice == 5) {
+                string query;
+                cout << "Query: "; cin.ignore(); getline(cin, query);
+                if (choice == 4) analyzer.PrintPipes(analyzer.SearchPipesByKmMark(query));
+                else analyzer.PrintStations(analyzer.SearchCompressByName(query));
+            } else cout << "Invalid option.\n";
+        }
     }
 
     void DisconnectNetwork() {
@@ -148,10 +264,15 @@ public:
     }
 
     void PerformTopologicalSort() {
-        vector<int> res = networkManager.TopologicalSort();
-        if(!res.empty()) {
+        TopologicalSortResult res = networkManager.TopologicalSort();
+        if (res.HasCycle()) {
+            cout << "\nERROR: Cycle detected! Topo sort impossible.\n";
+            cout << "Cycle (pipe IDs): ";
+            for (int id : res.cyclePipes) cout << id << " ";
+            cout << endl;
+        } else if(!res.order.empty()) {
             cout << "Topological Order: ";
-            for(int id : res) cout << id << " ";
+            for(int id : res.order) cout << id << " ";
             cout << endl;
         }
     }
@@ -166,7 +287,7 @@ public:
         cout << "Working: "; cin >> c.workshop_working;
         cout << "Class: "; cin.ignore(); getline(cin, c.classification);
         cout << "Status (0/1): "; cin >> c.working;
-        compressManager.Add(c);
+        compressManager.Emplace(move(c));
         logger.Log("ADDED CS");
     }
     
@@ -179,13 +300,75 @@ public:
         auto cs = compressManager.GetAll();
         for(auto& c : cs) cout << "ID:" << c.id << " " << c.name << endl;
     }
-    void EditPipeById() { int id; cout << "ID: "; cin >> id; Pipe* p = pipeManager.FindById(id); if(p) { cout << "New repair status (0/1): "; cin >> p->repair; } }
-    void EditCompressById() { int id; cout << "ID: "; cin >> id; Compress* c = compressManager.FindById(id); if(c) { cout << "New name: "; cin.ignore(); getline(cin, c->name); } }
+    void EditPipeById() { int id; cout << "ID: "; cin >> id; if(pipeManager.FindById(id)) { bool r; cout << "New repair status (0/1): "; cin >> r; pipeManager.SetRepair(id, r); } }
+    void EditCompressById() { int id; cout << "ID: "; cin >> id; if(compressManager.FindById(id)) { string name; cout << "New name: "; cin.ignore(); getline(cin, name); compressManager.Edit(id, [&](Compress& c) { c.name = name; }); } }
     void DeletePipe() { int id; cout << "ID: "; cin >> id; pipeManager.Delete(id); }
     void DeleteCompress() { int id; cout << "ID: "; cin >> id; compressManager.Delete(id); }
-    void SearchPipes() { searchEngine.SearchPipesById(pipeManager.GetAll(), 1); } // Заглушка, используй свой код
-    void SearchCompress() { searchEngine.SearchCompressById(compressManager.GetAll(), 1); } // Заглушка
-    void SaveData() { fileManager.SaveAllData(pipeManager, compressManager); }
+    // Поиск по нескольким условиям сразу; пустой ввод или -1 - условие не задано
+    void SearchPipes() {
+        vector<PipeQuery> conditions;
+        int diameter, repair;
+        double minLength, maxLength;
+        string kmMark, stationClass;
+        cout << "Diameter (-1 - any): "; cin >> diameter;
+        if (diameter >= 0) conditions.push_back(PipeWhere::Diameter(diameter));
+        cout << "Repair status (0/1, -1 - any): "; cin >> repair;
+        if (repair >= 0) conditions.push_back(PipeWhere::Repair(repair != 0));
+        cout << "Length range min max (-1 -1 - any): "; cin >> minLength >> maxLength;
+        if (minLength >= 0 && maxLength >= 0) conditions.push_back(PipeWhere::Length(minLength, maxLength));
+        if (cin.fail()) { cin.clear(); cin.ignore(10000, '\n'); cout << "Invalid input.\n"; return; }
+        cin.ignore(10000, '\n');
+        cout << "KM mark contains (empty - any): "; getline(cin, kmMark);
+        if (!kmMark.empty()) conditions.push_back(PipeWhere::KmMark(kmMark));
+        cout << "Linked to CS class (empty - any): "; getline(cin, stationClass);
+        if (!stationClass.empty()) {
+            conditions.push_back(PipeWhere::LinkedTo(compressManager, CompressWhere::Classification(stationClass)));
+        }
+        if (conditions.empty()) { ViewAllPipes(); return; }
+
+        PipeQuery query = conditions[0];
+        for (size_t i = 1; i < conditions.size(); i++) query = query && conditions[i];
+        auto cursor = queryPlanner.Run(query, pipeManager);
+        cout << "Found: " << cursor.Count() << endl;
+        while (const Pipe* p = cursor.Next()) {
+            cout << "ID:" << p->id << " Km:" << p->km_mark << " L:" << p->length << " D:" << p->diametr
+                 << (p->repair ? " [REPAIR]" : "") << (p->source_cs_id ? " [LINKED]" : "") << endl;
+        }
+    }
+
+    void SearchCompress() {
+        vector<CompressQuery> conditions;
+        string name, classification;
+        int working;
+        double minPercent, maxPercent;
+        cin.ignore(10000, '\n');
+        cout << "Name contains (empty - any): "; getline(cin, name);
+        if (!name.empty()) conditions.push_back(CompressWhere::Name(name));
+        cout << "Class contains (empty - any): "; getline(cin, classification);
+        if (!classification.empty()) conditions.push_back(CompressWhere::Classification(classification));
+        cout << "Status (0/1, -1 - any): "; cin >> working;
+        if (working >= 0) conditions.push_back(CompressWhere::Working(working != 0));
+        cout << "Working workshops % range min max (-1 -1 - any): "; cin >> minPercent >> maxPercent;
+        if (minPercent >= 0 && maxPercent >= 0) conditions.push_back(CompressWhere::WorkshopPercentage(minPercent, maxPercent));
+        if (cin.fail()) { cin.clear(); cin.ignore(10000, '\n'); cout << "Invalid input.\n"; return; }
+        if (conditions.empty()) { ViewAllCompress(); return; }
+
+        CompressQuery query = conditions[0];
+        for (size_t i = 1; i < conditions.size(); i++) query = query && conditions[i];
+        auto cursor = queryPlanner.Run(query, compressManager);
+        cout << "Found: " << cursor.Count() << endl;
+        while (const Compress* c = cursor.Next()) {
+            cout << "ID:" << c->id << " " << c->name << " (" << c->classification << ") Workshops: "
+                 << c->workshop_working << "/" << c->workshop_count << (c->working ? "" : " [STOPPED]") << endl;
+        }
+    }
+    void SaveData() {
+        cout << "Format (1 - text, 2 - binary snapshot, 3 - changes only (journal)): ";
+        int format; cin >> format;
+        if (format == 2) fileManager.SaveSnapshot(pipeManager, compressManager);
+        else if (format == 3) fileManager.SaveIncremental(pipeManager, compressManager);
+        else fileManager.SaveAllData(pipeManager, compressManager);
+    }
     void LoadData(int& p, int& c) { fileManager.LoadAllData(pipeManager, compressManager, p, c); }
     void ViewLogs() { logger.ViewLogs(); }
 };